@@ -20,7 +20,11 @@
 
 #include "PkStrings.h"
 
+#include <QCoreApplication>
 #include <QDebug>
+#include <QEvent>
+#include <QHash>
+#include <QPointer>
 
 #include <KLocalizedString>
 #include <KFormat>
@@ -29,7 +33,91 @@
 
 using namespace PackageKit;
 
-QString PkStrings::status(Transaction::Status status, uint speed, qulonglong downloadRemaining)
+namespace
+{
+    enum Table {
+        StatusTable,
+        StatusPastTable,
+        ActionTable,
+        ActionPastTable,
+        InfoPresentTable,
+        InfoPastTable,
+        ErrorTable,
+        ErrorMessageTable,
+        GroupsTable,
+        InfoTable,
+        RestartTypeFutureTable,
+        RestartTypeTable,
+        UpdateStateTable,
+        DaemonErrorTable
+    };
+
+    /**
+     * The translated strings for the enum values, looked up once per language,
+     * and a formatter shared by all the calls
+     */
+    class StringCache : public QObject
+    {
+    public:
+        /**
+         * Follow the language of the application, which might not have existed
+         * yet when the first string was looked up
+         */
+        void watchLanguage()
+        {
+            QCoreApplication * app = QCoreApplication::instance();
+            if (!app || app == m_app)
+                return;
+
+            // looked up without this application, and possibly before its translations were loaded
+            clear();
+            m_app = app;
+            app->installEventFilter(this);
+        }
+
+        bool eventFilter(QObject *watched, QEvent *event) Q_DECL_OVERRIDE
+        {
+            if (watched == m_app.data() && event->type() == QEvent::LanguageChange)
+                clear();
+            return false;
+        }
+
+        QHash<quint64, QString> strings;
+        KFormat format;
+
+    private:
+        void clear()
+        {
+            strings.clear();
+            format = KFormat();
+        }
+
+        QPointer<QCoreApplication> m_app;
+    };
+
+    Q_GLOBAL_STATIC(StringCache, s_cache)
+
+    StringCache * stringCache()
+    {
+        StringCache * cache = s_cache();
+        cache->watchLanguage();
+        return cache;
+    }
+
+    template<typename Func>
+    QString cached(Table table, int value, Func translate)
+    {
+        StringCache * cache = stringCache();
+        const quint64 key = (quint64(table) << 32) | quint32(value);
+        const auto it = cache->strings.constFind(key);
+        if (it != cache->strings.constEnd())
+            return *it;
+
+        return *cache->strings.insert(key, translate());
+    }
+} // namespace {
+
+static QString statusText(Transaction::Status status, uint speed, qulonglong downloadRemaining)
 {
     switch (status) {
     case Transaction::StatusUnknown:
@@ -57,16 +145,16 @@ QString PkStrings::status(Transaction::Status status, uint speed, qulonglong dow
         if (speed != 0 && downloadRemaining != 0) {
             return i18nc("transaction state, downloading package files",
                          "Downloading at %1/s, %2 remaining",
-                         KFormat().formatByteSize(speed),
-                         KFormat().formatByteSize(downloadRemaining));
+                         stringCache()->format.formatByteSize(speed),
+                         stringCache()->format.formatByteSize(downloadRemaining));
         } else if (speed != 0 && downloadRemaining == 0) {
             return i18nc("transaction state, downloading package files",
                          "Downloading at %1/s",
-                         KFormat().formatByteSize(speed));
+                         stringCache()->format.formatByteSize(speed));
         } else if (speed == 0 && downloadRemaining != 0) {
             return i18nc("transaction state, downloading package files",
                          "Downloading, %1 remaining",
-                         KFormat().formatByteSize(downloadRemaining));
+                         stringCache()->format.formatByteSize(downloadRemaining));
         } else {
             return i18nc("transaction state, downloading package files",
                          "Downloading");
@@ -160,7 +248,7 @@ QString PkStrings::status(Transaction::Status status, uint speed, qulonglong dow
     return QString();
 }
 
-QString PkStrings::statusPast(Transaction::Status status)
+static QString statusPastText(Transaction::Status status)
 {
     switch (status) {
     case Transaction::StatusDownload:
@@ -181,7 +269,7 @@ QString PkStrings::statusPast(Transaction::Status status)
     }
 }
 
-QString PkStrings::action(Transaction::Role role, Transaction::TransactionFlags flags)
+static QString actionText(Transaction::Role role, Transaction::TransactionFlags flags)
 {
     switch (role) {
     case Transaction::RoleUnknown :
@@ -273,7 +361,7 @@ QString PkStrings::action(Transaction::Role role, Transaction::TransactionFlags
     return QString();
 }
 
-QString PkStrings::actionPast(Transaction::Role action)
+static QString actionPastText(Transaction::Role action)
 {
     switch (action) {
     case Transaction::RoleUnknown:
@@ -345,7 +433,7 @@ QString PkStrings::actionPast(Transaction::Role action)
     return QString();
 }
 
-QString PkStrings::infoPresent(Transaction::Info info)
+static QString infoPresentText(Transaction::Info info)
 {
     switch (info) {
     case Transaction::InfoDownloading :
@@ -372,7 +460,7 @@ QString PkStrings::infoPresent(Transaction::Info info)
     }
 }
 
-QString PkStrings::infoPast(Transaction::Info info)
+static QString infoPastText(Transaction::Info info)
 {
     switch (info) {
     case Transaction::InfoDownloading :
@@ -399,7 +487,7 @@ QString PkStrings::infoPast(Transaction::Info info)
     }
 }
 
-QString PkStrings::error(Transaction::Error error)
+static QString errorText(Transaction::Error error)
 {
     switch (error) {
     case Transaction::ErrorNoNetwork :
@@ -543,7 +631,7 @@ QString PkStrings::error(Transaction::Error error)
     return QString();
 }
 
-QString PkStrings::errorMessage(Transaction::Error error)
+static QString errorMessageText(Transaction::Error error)
 {
     switch (error) {
     case Transaction::ErrorNoNetwork :
@@ -727,7 +815,7 @@ QString PkStrings::errorMessage(Transaction::Error error)
     return QString();
 }
 
-QString PkStrings::groups(Transaction::Group group)
+static QString groupsText(Transaction::Group group)
 {
     switch (group) {
     case Transaction::GroupAccessibility :
@@ -805,7 +893,7 @@ QString PkStrings::groups(Transaction::Group group)
     return QString();
 }
 
-QString PkStrings::info(int state)
+static QString infoText(int state)
 {
     Transaction::Info stateEnum = static_cast<Transaction::Info>(state);
     switch (stateEnum) {
@@ -863,7 +951,7 @@ QString PkStrings::packageQuantity(bool updates, int packages, int selected)
     }
 }
 
-QString PkStrings::restartTypeFuture(Transaction::Restart value)
+static QString restartTypeFutureText(Transaction::Restart value)
 {
     switch (value) {
     case Transaction::RestartNone:
@@ -886,7 +974,7 @@ QString PkStrings::restartTypeFuture(Transaction::Restart value)
     return QString();
 }
 
-QString PkStrings::restartType(Transaction::Restart value)
+static QString restartTypeText(Transaction::Restart value)
 {
     switch (value) {
     case Transaction::RestartNone:
@@ -909,7 +997,7 @@ QString PkStrings::restartType(Transaction::Restart value)
     return QString();
 }
 
-QString PkStrings::updateState(Transaction::UpdateState value)
+static QString updateStateText(Transaction::UpdateState value)
 {
     switch (value) {
     case Transaction::UpdateStateStable:
@@ -942,7 +1030,7 @@ QString PkStrings::mediaMessage(Transaction::MediaType value, const QString &tex
     return i18n("Please insert the medium labeled '%1', and press continue.", text);
 }
 
-QString PkStrings::daemonError(int value)
+static QString daemonErrorText(int value)
 {
     Transaction::InternalError statusEnum = static_cast<Transaction::InternalError>(value);
     switch (statusEnum) {
@@ -974,9 +1062,83 @@ QString PkStrings::daemonError(int value)
     return i18n("An unknown error happened.");
 }
 
+QString PkStrings::status(Transaction::Status status, uint speed, qulonglong downloadRemaining)
+{
+    // only the download status depends on the speed and remaining size
+    if (status == Transaction::StatusDownload && (speed != 0 || downloadRemaining != 0))
+        return statusText(status, speed, downloadRemaining);
+
+    return cached(StatusTable, status, [status] { return statusText(status, 0, 0); });
+}
+
+QString PkStrings::statusPast(Transaction::Status status)
+{
+    return cached(StatusPastTable, status, [status] { return statusPastText(status); });
+}
+
+QString PkStrings::action(Transaction::Role role, Transaction::TransactionFlags flags)
+{
+    return cached(ActionTable, (int(flags) << 8) | role, [role, flags] { return actionText(role, flags); });
+}
+
+QString PkStrings::actionPast(Transaction::Role action)
+{
+    return cached(ActionPastTable, action, [action] { return actionPastText(action); });
+}
+
+QString PkStrings::infoPresent(Transaction::Info info)
+{
+    return cached(InfoPresentTable, info, [info] { return infoPresentText(info); });
+}
+
+QString PkStrings::infoPast(Transaction::Info info)
+{
+    return cached(InfoPastTable, info, [info] { return infoPastText(info); });
+}
+
+QString PkStrings::error(Transaction::Error error)
+{
+    return cached(ErrorTable, error, [error] { return errorText(error); });
+}
+
+QString PkStrings::errorMessage(Transaction::Error error)
+{
+    return cached(ErrorMessageTable, error, [error] { return errorMessageText(error); });
+}
+
+QString PkStrings::groups(Transaction::Group group)
+{
+    return cached(GroupsTable, group, [group] { return groupsText(group); });
+}
+
+QString PkStrings::info(int state)
+{
+    return cached(InfoTable, state, [state] { return infoText(state); });
+}
+
+QString PkStrings::restartTypeFuture(Transaction::Restart value)
+{
+    return cached(RestartTypeFutureTable, value, [value] { return restartTypeFutureText(value); });
+}
+
+QString PkStrings::restartType(Transaction::Restart value)
+{
+    return cached(RestartTypeTable, value, [value] { return restartTypeText(value); });
+}
+
+QString PkStrings::updateState(Transaction::UpdateState value)
+{
+    return cached(UpdateStateTable, value, [value] { return updateStateText(value); });
+}
+
+QString PkStrings::daemonError(int value)
+{
+    return cached(DaemonErrorTable, value, [value] { return daemonErrorText(value); });
+}
+
 QString PkStrings::prettyFormatDuration(unsigned long mSec)
 {
-    return KFormat().formatDuration(mSec);
+    return stringCache()->format.formatDuration(mSec);
 }
 
 QString PkStrings::lastCacheRefreshTitle(uint lastTime)
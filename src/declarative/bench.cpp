@@ -0,0 +1,245 @@
+/*
+    Copyright (C) 2026 agent <agent@local>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QQmlComponent>
+#include <QQmlEngine>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QTimer>
+
+#include "faketransactionsource.h"
+#include "pkupdates.h"
+#include "pkupdatesmodel.h"
+
+namespace
+{
+    // what a view does with each row, without the cost of painting it
+    const char s_qmlPopulation[] =
+        "import QtQml 2.2\n"
+        "Instantiator {\n"
+        "    delegate: QtObject {\n"
+        "        readonly property string label: name + ' (' + version + ')'\n"
+        "        readonly property string text: summary\n"
+        "        readonly property bool security: severity == 2\n"
+        "    }\n"
+        "}\n";
+
+    // longer than getting any of the updates replayed takes
+    const int s_getUpdatesTimeout = 10 * 60 * 1000; // ms
+
+    struct Result {
+        QVector<double> streaming;  // until the last package was handled
+        QVector<double> first;      // until the first rows reached the model, by the batch, the timer or the first security update
+        QVector<double> updated;    // until done()
+        QVector<double> warm;       // same stream again, nothing changes
+        QVector<double> qml;        // populating the QML instantiator
+    };
+
+    double msecs(qint64 nsecs)
+    {
+        return nsecs / 1000000.0;
+    }
+
+    double median(QVector<double> values)
+    {
+        if (values.isEmpty())
+            return 0;
+        std::sort(values.begin(), values.end());
+        return values.at(values.count() / 2);
+    }
+
+    // peak resident set size of the process in kB, from /proc
+    qint64 peakMemory()
+    {
+        QFile status(QStringLiteral("/proc/self/status"));
+        if (!status.open(QIODevice::ReadOnly | QIODevice::Text))
+            return -1;
+
+        const QList<QByteArray> lines = status.readAll().split('\n');
+        for (const QByteArray &line : lines) {
+            if (line.startsWith("VmHWM:"))
+                return line.mid(6).trimmed().split(' ').value(0).toLongLong();
+        }
+        return -1;
+    }
+
+    void removeCache()
+    {
+        QFile::remove(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) +
+                      QStringLiteral("/plasma-pk-updates/updates.cache"));
+    }
+
+    /*
+     * Gets the updates through the transactions of the source, as the event loop of plasmashell would.
+     * @return false if done() wasn't emitted within s_getUpdatesTimeout
+     */
+    bool getUpdates(PkUpdates *upd)
+    {
+        QEventLoop loop;
+        QObject::connect(upd, &PkUpdates::done, &loop, &QEventLoop::quit);
+        QTimer::singleShot(s_getUpdatesTimeout, &loop, [&loop] { loop.exit(1); });
+        // a private slot, PkUpdates only runs it on its own
+        QMetaObject::invokeMethod(upd, "getUpdates");
+        return loop.exec() == 0;
+    }
+
+    void run(FakeTransactionSource &source, QQmlComponent &component, Result &result)
+    {
+        removeCache();
+        PkUpdates * upd = new PkUpdates;
+        upd->setTransactionFactory(&source);
+        upd->activate();
+
+        QElapsedTimer timer;
+        int found = 0;
+        qint64 streamed = -1;
+        qint64 first = -1;
+        qint64 updated = -1;
+        QObject::connect(upd, &PkUpdates::updateFound, [&] {
+            if (++found == source.count())
+                streamed = timer.nsecsElapsed();
+        });
+        QObject::connect(upd, &PkUpdates::updatesChanged, [&] {
+            if (first < 0)
+                first = timer.nsecsElapsed();
+        });
+        QObject::connect(upd, &PkUpdates::done, [&] {
+            if (updated < 0)
+                updated = timer.nsecsElapsed();
+        });
+
+        timer.start();
+        if (!getUpdates(upd))
+            qWarning() << "Getting" << source.count() << "updates didn't finish";
+        result.streaming << msecs(streamed);
+        result.first << msecs(first);
+        result.updated << msecs(updated);
+
+        timer.start();
+        if (!getUpdates(upd))
+            qWarning() << "Getting" << source.count() << "updates again didn't finish";
+        result.warm << msecs(timer.nsecsElapsed());
+
+        PkUpdatesModel model;
+        QObject * instantiator = component.create();
+        instantiator->setProperty("model", QVariant::fromValue<QObject *>(&model));
+        timer.start();
+        model.setUpdates(upd->updatesModel()->updates());
+        result.qml << msecs(timer.nsecsElapsed());
+        if (instantiator->property("count").toInt() != source.count())
+            qWarning() << "The instantiator created" << instantiator->property("count").toInt() << "objects instead of" << source.count();
+
+        delete instantiator;
+        delete upd;
+        // the transactions PkUpdates left for later
+        QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+    }
+} // namespace {
+
+int main(int argc, char *argv[])
+{
+    // neither touch the cache and config of the user nor publish the fake updates to the session,
+    // nor let the fake transactions reach the daemon
+    QStandardPaths::setTestModeEnabled(true);
+    qputenv("DBUS_SESSION_BUS_ADDRESS", "disabled:");
+    qputenv("DBUS_SYSTEM_BUS_ADDRESS", "disabled:");
+
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("PkBench");
+    app.setApplicationVersion(PROJECT_VERSION);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Benchmarks the handling of GetUpdates transactions by replaying them into PkUpdates."));
+    parser.addHelpOption();
+    parser.addVersionOption();
+    const QCommandLineOption sizesOption(QStringLiteral("sizes"), QStringLiteral("Comma separated numbers of updates to generate."),
+                                         QStringLiteral("sizes"), QStringLiteral("10,1000,10000,50000"));
+    const QCommandLineOption replayOption(QStringLiteral("replay"),
+                                          QStringLiteral("Replay the output of \"plasmapk-console list --format tsv\" instead."),
+                                          QStringLiteral("file"));
+    const QCommandLineOption iterationsOption(QStringLiteral("iterations"), QStringLiteral("Runs per size, the median is reported."),
+                                              QStringLiteral("count"), QStringLiteral("5"));
+    parser.addOption(sizesOption);
+    parser.addOption(replayOption);
+    parser.addOption(iterationsOption);
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    bool ok;
+    const int iterations = parser.value(iterationsOption).toInt(&ok);
+    if (!ok || iterations < 1) {
+        err << "Invalid number of iterations: " << parser.value(iterationsOption) << '\n';
+        return 2;
+    }
+
+    QList<int> sizes;
+    if (!parser.isSet(replayOption)) {
+        for (const QString &size : parser.value(sizesOption).split(QLatin1Char(','), QString::SkipEmptyParts)) {
+            sizes << size.toInt(&ok);
+            if (!ok || sizes.last() < 0) {
+                err << "Invalid size: " << size << '\n';
+                return 2;
+            }
+        }
+        // the peak memory only grows, measure the small sets first
+        std::sort(sizes.begin(), sizes.end());
+    }
+
+    QQmlEngine engine;
+    QQmlComponent component(&engine);
+    component.setData(s_qmlPopulation, QUrl());
+    if (component.isError()) {
+        err << component.errorString() << '\n';
+        return 1;
+    }
+
+    out << "updates\tstreaming_ms\tfirst_rows_ms\tdone_ms\twarm_ms\tqml_ms\tpeak_rss_kb\n";
+    auto report = [&] (FakeTransactionSource &source) {
+        Result result;
+        for (int i = 0; i < iterations; ++i)
+            run(source, component, result);
+        out << source.count() << '\t' << median(result.streaming) << '\t' << median(result.first) << '\t'
+            << median(result.updated) << '\t' << median(result.warm) << '\t' << median(result.qml) << '\t' << peakMemory() << '\n';
+        out.flush();
+    };
+
+    FakeTransactionSource source;
+    if (parser.isSet(replayOption)) {
+        if (!source.load(parser.value(replayOption))) {
+            err << "Failed to read " << parser.value(replayOption) << '\n';
+            return 1;
+        }
+        report(source);
+    } else {
+        for (int size : sizes) {
+            source.generate(size);
+            report(source);
+        }
+    }
+
+    removeCache();
+    return 0;
+}
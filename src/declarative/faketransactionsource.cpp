@@ -0,0 +1,243 @@
+/***************************************************************************
+ *   Copyright (C) 2026 agent <agent@local>                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; see the file COPYING. If not, write to       *
+ *   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,  *
+ *   Boston, MA 02110-1301, USA.                                           *
+ ***************************************************************************/
+
+#include <QDBusObjectPath>
+#include <QDateTime>
+#include <QFile>
+#include <QPointer>
+#include <QTextStream>
+#include <QTimer>
+
+#include "faketransactionsource.h"
+
+namespace
+{
+    // the daemon reports its progress every now and then while listing the updates
+    const int s_statusInterval = 50;
+    // updates emitted per pass of the event loop, about what arrives with one read from the bus
+    const int s_updatesPerPass = 100;
+    // one in so many changelogs is long enough to get compressed in the details cache
+    const int s_longChangelogInterval = 50;
+} // namespace {
+
+FakeTransactionSource::FakeTransactionSource(QObject *parent) :
+    TransactionFactory(parent)
+{
+}
+
+FakeTransactionSource::~FakeTransactionSource()
+{
+}
+
+void FakeTransactionSource::generate(int count)
+{
+    m_packages.clear();
+    m_packages.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        // roughly the mix of a distribution: a few security and important updates, the rest normal,
+        // and none of the former first, which PkUpdates would publish right away
+        PackageKit::Transaction::Info info = PackageKit::Transaction::InfoNormal;
+        if (i % 20 == 19)
+            info = PackageKit::Transaction::InfoSecurity;
+        else if (i % 10 == 9)
+            info = PackageKit::Transaction::InfoImportant;
+
+        m_packages.append({info,
+                           QStringLiteral("package-%1;%2.%3.%4-1;x86_64;updates").arg(i).arg(i % 7).arg(i % 13).arg(i % 31),
+                           QStringLiteral("Summary of package number %1, long enough to look like a real one").arg(i)});
+    }
+    indexPackages();
+}
+
+bool FakeTransactionSource::load(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+
+    m_packages.clear();
+    QTextStream stream(&file);
+    while (!stream.atEnd()) {
+        const QString line = stream.readLine();
+        if (line.isEmpty() || line.startsWith(QLatin1Char('#')))
+            continue;
+
+        // id, name, version, arch, severity, summary
+        const QStringList fields = line.split(QLatin1Char('\t'));
+        if (fields.count() < 6)
+            continue;
+
+        PackageKit::Transaction::Info info = PackageKit::Transaction::InfoNormal;
+        if (fields.at(4) == QLatin1String("security"))
+            info = PackageKit::Transaction::InfoSecurity;
+        else if (fields.at(4) == QLatin1String("important"))
+            info = PackageKit::Transaction::InfoImportant;
+        m_packages.append({info, fields.at(0), fields.at(5)});
+    }
+    indexPackages();
+    return true;
+}
+
+int FakeTransactionSource::count() const
+{
+    return m_packages.count();
+}
+
+int FakeTransactionSource::startedTransactions() const
+{
+    return m_lastTransaction;
+}
+
+PackageKit::Transaction * FakeTransactionSource::refreshCache(bool force)
+{
+    Q_UNUSED(force)
+    return start(RefreshScript);
+}
+
+PackageKit::Transaction * FakeTransactionSource::getUpdates()
+{
+    return start(UpdatesScript);
+}
+
+PackageKit::Transaction * FakeTransactionSource::getUpdatesDetails(const QStringList &packageIDs)
+{
+    return start(DetailsScript, packageIDs);
+}
+
+PackageKit::Transaction * FakeTransactionSource::updatePackages(const QStringList &packageIDs, PackageKit::Transaction::TransactionFlags flags)
+{
+    if (flags.testFlag(PackageKit::Transaction::TransactionFlagSimulate))
+        return start(SimulateScript, packageIDs);
+    if (flags.testFlag(PackageKit::Transaction::TransactionFlagOnlyDownload))
+        return start(DownloadScript, packageIDs);
+    return start(InstallScript, packageIDs);
+}
+
+PackageKit::Transaction * FakeTransactionSource::acceptEula(const QString &eulaID)
+{
+    Q_UNUSED(eulaID)
+    return start(EulaScript);
+}
+
+PackageKit::Daemon::Network FakeTransactionSource::networkState() const
+{
+    return PackageKit::Daemon::NetworkOnline;
+}
+
+bool FakeTransactionSource::isDaemon() const
+{
+    return false;
+}
+
+PackageKit::Transaction * FakeTransactionSource::start(Script script, const QStringList &packageIDs)
+{
+    // a path no daemon has a transaction at, so that only the replay drives it
+    PackageKit::Transaction * trans = new PackageKit::Transaction(QDBusObjectPath(QStringLiteral("/fake/%1").arg(++m_lastTransaction)));
+
+    // like the daemon, only start once the caller connected to it; whoever started it deletes it
+    QPointer<PackageKit::Transaction> guard(trans);
+    QTimer::singleShot(0, this, [this, guard, script, packageIDs] {
+        if (guard)
+            run(guard.data(), script, packageIDs);
+    });
+    return trans;
+}
+
+void FakeTransactionSource::run(PackageKit::Transaction *trans, Script script, const QStringList &packageIDs)
+{
+    emit trans->statusChanged();
+    switch (script) {
+    case UpdatesScript:
+        streamUpdates(trans, 0);
+        return;
+    case DetailsScript:
+        for (const QString &packageID : packageIDs) {
+            const int index = m_rows.value(packageID, -1);
+            if (index != -1)
+                emitUpdateDetail(index, trans);
+        }
+        break;
+    case InstallScript: {
+        bool restart = false;
+        for (const QString &packageID : packageIDs) {
+            const Package pkg = m_packages.value(m_rows.value(packageID, -1), {PackageKit::Transaction::InfoNormal, packageID, QString()});
+            emit trans->package(PackageKit::Transaction::InfoUpdating, pkg.packageID, pkg.summary);
+            if (!restart && pkg.info == PackageKit::Transaction::InfoSecurity) {
+                restart = true;
+                emit trans->requireRestart(PackageKit::Transaction::RestartSystem, pkg.packageID);
+            }
+        }
+        break;
+    }
+    case RefreshScript:
+    case SimulateScript:
+    case DownloadScript:
+    case EulaScript:
+        break;
+    }
+    emit trans->finished(PackageKit::Transaction::ExitSuccess, 0);
+}
+
+void FakeTransactionSource::streamUpdates(PackageKit::Transaction *trans, int first)
+{
+    const int last = qMin(first + s_updatesPerPass, m_packages.count());
+    for (int i = first; i < last; ++i) {
+        const Package &pkg = m_packages.at(i);
+        emit trans->package(pkg.info, pkg.packageID, pkg.summary);
+        if (i % s_statusInterval == 0)
+            emit trans->statusChanged();
+    }
+
+    if (last == m_packages.count()) {
+        emit trans->finished(PackageKit::Transaction::ExitSuccess, 0);
+        return;
+    }
+
+    QPointer<PackageKit::Transaction> guard(trans);
+    QTimer::singleShot(0, this, [this, guard, last] {
+        if (guard)
+            streamUpdates(guard.data(), last);
+    });
+}
+
+void FakeTransactionSource::emitUpdateDetail(int index, PackageKit::Transaction *trans)
+{
+    const Package &pkg = m_packages.at(index);
+    const QDateTime issued = QDateTime::currentDateTimeUtc();
+    QString changelog = QStringLiteral("* Fixed the issues reported against %1\n").arg(pkg.packageID);
+    if (index % s_longChangelogInterval == 0)
+        changelog = changelog.repeated(400);
+
+    QStringList cveUrls;
+    if (pkg.info == PackageKit::Transaction::InfoSecurity)
+        cveUrls << QStringLiteral("https://cve.example.org/CVE-2016-%1").arg(index);
+
+    const QStringList bugzillaUrls = QStringList() << QStringLiteral("https://bugs.example.org/%1").arg(index);
+    emit trans->updateDetail(pkg.packageID, QStringList(), QStringList(), QStringList(), bugzillaUrls, cveUrls,
+                             PackageKit::Transaction::RestartNone, pkg.summary, changelog,
+                             PackageKit::Transaction::UpdateStateStable, issued, issued);
+}
+
+void FakeTransactionSource::indexPackages()
+{
+    m_rows.clear();
+    m_rows.reserve(m_packages.count());
+    for (int i = 0; i < m_packages.count(); ++i)
+        m_rows.insert(m_packages.at(i).packageID, i);
+}
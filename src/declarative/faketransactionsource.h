@@ -0,0 +1,120 @@
+/***************************************************************************
+ *   Copyright (C) 2026 agent <agent@local>                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; see the file COPYING. If not, write to       *
+ *   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,  *
+ *   Boston, MA 02110-1301, USA.                                           *
+ ***************************************************************************/
+
+#ifndef PLASMA_PK_FAKE_TRANSACTION_SOURCE_H
+#define PLASMA_PK_FAKE_TRANSACTION_SOURCE_H
+
+#include <QHash>
+#include <QVector>
+
+#include <PackageKit/Transaction>
+
+#include "transactionfactory.h"
+
+/**
+ * @brief The FakeTransactionSource class
+ *
+ * Replays the signal streams of PackageKit transactions into PkUpdates
+ * without asking a PackageKit daemon, for benchmarking and soak testing. The
+ * updates are either generated or loaded from the TSV output of
+ * plasmapk-console.
+ *
+ * As a TransactionFactory it starts transactions unknown to the daemon, and
+ * replays their part of the stream on them once PkUpdates connected to them:
+ * the updates, the details asked for, a simulation, an installation or a
+ * download. Those go through the transaction handling of PkUpdates, finishing
+ * successfully. The updates arrive a few at a time, with the event loop
+ * running in between as it does for the signals of the daemon. PkUpdates reads
+ * the status from the transaction that sent it, so replayed status changes
+ * only cost their dispatch.
+ *
+ * The transactions are still PackageKit::Transaction objects with a proxy on
+ * the system bus, which has to be disabled for the replay to be the only
+ * thing driving them.
+ */
+class FakeTransactionSource : public TransactionFactory
+{
+    Q_OBJECT
+
+public:
+    explicit FakeTransactionSource(QObject *parent = nullptr);
+    ~FakeTransactionSource();
+
+    /**
+     * Generate a stream of @p count updates, the same for the same count. It
+     * starts with normal updates, one in ten is important and one in twenty a
+     * security update.
+     */
+    void generate(int count);
+
+    /**
+     * Load a stream recorded with "plasmapk-console list --format tsv"
+     * @return false if the file can't be read
+     */
+    bool load(const QString &fileName);
+
+    /**
+     * @return the number of updates in the stream
+     */
+    int count() const;
+
+    /**
+     * @return the number of transactions started through the source so far
+     */
+    int startedTransactions() const;
+
+    PackageKit::Transaction * refreshCache(bool force) Q_DECL_OVERRIDE;
+    PackageKit::Transaction * getUpdates() Q_DECL_OVERRIDE;
+    PackageKit::Transaction * getUpdatesDetails(const QStringList &packageIDs) Q_DECL_OVERRIDE;
+    PackageKit::Transaction * updatePackages(const QStringList &packageIDs, PackageKit::Transaction::TransactionFlags flags) Q_DECL_OVERRIDE;
+    PackageKit::Transaction * acceptEula(const QString &eulaID) Q_DECL_OVERRIDE;
+    PackageKit::Daemon::Network networkState() const Q_DECL_OVERRIDE;
+    bool isDaemon() const Q_DECL_OVERRIDE;
+
+private:
+    struct Package {
+        PackageKit::Transaction::Info info;
+        QString packageID;
+        QString summary;
+    };
+
+    enum Script {
+        RefreshScript,
+        UpdatesScript,
+        DetailsScript,
+        SimulateScript,
+        InstallScript,
+        DownloadScript,
+        EulaScript
+    };
+
+    PackageKit::Transaction * start(Script script, const QStringList &packageIDs = QStringList());
+    void run(PackageKit::Transaction *trans, Script script, const QStringList &packageIDs);
+    // emits the updates from the @p first th on, the rest in the next passes of the event loop
+    void streamUpdates(PackageKit::Transaction *trans, int first);
+    void emitUpdateDetail(int index, PackageKit::Transaction *trans);
+    void indexPackages();
+
+    QVector<Package> m_packages;
+    // the index of each package ID in m_packages
+    QHash<QString, int> m_rows;
+    int m_lastTransaction = 0;
+};
+
+#endif // PLASMA_PK_FAKE_TRANSACTION_SOURCE_H
@@ -15,20 +15,461 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <climits>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include <QCommandLineParser>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QTimer>
 #include <QtWidgets/QApplication>
 
+#include "faketransactionsource.h"
 #include "pkupdates.h"
+#include "pkupdatesmodel.h"
+
+namespace
+{
+    enum Format {
+        Tsv,
+        Json
+    };
+
+    enum ExitCode {
+        ExitOk = 0,
+        ExitFailed = 1,
+        ExitUsage = 2
+    };
+
+    QString severityName(int severity)
+    {
+        switch (severity) {
+        case PkUpdatesModel::SecuritySeverity:
+            return QStringLiteral("security");
+        case PkUpdatesModel::ImportantSeverity:
+            return QStringLiteral("important");
+        default:
+            return QStringLiteral("normal");
+        }
+    }
+
+    QString tsvField(QString value)
+    {
+        return value.replace(QLatin1Char('\t'), QLatin1Char(' ')).replace(QLatin1Char('\n'), QLatin1Char(' '));
+    }
+
+    void printUpdate(QTextStream &out, Format format, const QString &packageID, const QString &summary, int severity)
+    {
+        const QStringList fields = packageID.split(QLatin1Char(';'));
+        if (format == Json) {
+            const QJsonObject update {
+                {QStringLiteral("type"), QStringLiteral("update")},
+                {QStringLiteral("id"), packageID},
+                {QStringLiteral("name"), fields.value(0)},
+                {QStringLiteral("version"), fields.value(1)},
+                {QStringLiteral("arch"), fields.value(2)},
+                {QStringLiteral("repo"), fields.value(3)},
+                {QStringLiteral("severity"), severityName(severity)},
+                {QStringLiteral("summary"), summary}
+            };
+            out << QJsonDocument(update).toJson(QJsonDocument::Compact) << '\n';
+        } else {
+            out << tsvField(packageID) << '\t' << tsvField(fields.value(0)) << '\t' << tsvField(fields.value(1)) << '\t'
+                << tsvField(fields.value(2)) << '\t' << severityName(severity) << '\t' << tsvField(summary) << '\n';
+        }
+        out.flush();
+    }
+
+    void printSummary(QTextStream &out, Format format, const QString &event, PkUpdates *upd)
+    {
+        if (format == Json) {
+            const QJsonObject summary {
+                {QStringLiteral("type"), event},
+                {QStringLiteral("success"), upd->lastCheckSuccessful()},
+                {QStringLiteral("updates"), upd->count()},
+                {QStringLiteral("important"), upd->importantCount()},
+                {QStringLiteral("security"), upd->securityCount()},
+                {QStringLiteral("lastRefresh"), upd->lastRefreshTimestamp()}
+            };
+            out << QJsonDocument(summary).toJson(QJsonDocument::Compact) << '\n';
+        } else {
+            // comment lines, so that the updates can still be cut(1)
+            out << '#' << event << '\t' << (upd->lastCheckSuccessful() ? "ok" : "failed") << '\t' << upd->count() << '\t'
+                << upd->importantCount() << '\t' << upd->securityCount() << '\t' << upd->lastRefreshTimestamp() << '\n';
+        }
+        out.flush();
+    }
+
+    // update details fetched per soak cycle, about what browsing the list does
+    const int s_soakDetailCount = 100;
+    // longer than any step of a soak cycle takes against replayed transactions
+    const int s_soakStepTimeout = 60 * 1000; // ms
+    // lines printed by a soak run, besides the first and the last cycle
+    const int s_soakReports = 20;
+
+    // bytes taken from the heap and not freed yet, -1 where unknown
+    qint64 heapInUse()
+    {
+#ifdef __GLIBC__
+#if __GLIBC_PREREQ(2, 33)
+        return qint64(mallinfo2().uordblks);
+#else
+        return qint64(uint(mallinfo().uordblks));
+#endif
+#else
+        return -1;
+#endif
+    }
+
+    // resident set size of the process in kB, from /proc
+    qint64 residentMemory()
+    {
+        QFile status(QStringLiteral("/proc/self/status"));
+        if (!status.open(QIODevice::ReadOnly | QIODevice::Text))
+            return -1;
+
+        const QList<QByteArray> lines = status.readAll().split('\n');
+        for (const QByteArray &line : lines) {
+            if (line.startsWith("VmRSS:"))
+                return line.mid(6).trimmed().split(' ').value(0).toLongLong();
+        }
+        return -1;
+    }
+
+    struct SoakSample {
+        int cycle;
+        int started;
+        int transactions;
+        int objects;
+        qint64 heap;
+        qint64 rss;
+    };
+
+    SoakSample soakSample(int cycle, int started, PkUpdates *upd)
+    {
+        return {cycle, started, upd->outstandingTransactions(), upd->findChildren<QObject *>().count(), heapInUse(), residentMemory()};
+    }
+
+    void printSoakSample(QTextStream &out, Format format, const SoakSample &sample, const SoakSample &baseline)
+    {
+        // the first cycle fills the caches, only the growth after it counts
+        const int cycles = sample.cycle - baseline.cycle;
+        // the net growth of the heap in use, allocations freed within a cycle don't show
+        const qint64 heapGrowthPerCycle = cycles > 0 && sample.heap >= 0 ? (sample.heap - baseline.heap) / cycles : 0;
+        if (format == Json) {
+            const QJsonObject soak {
+                {QStringLiteral("type"), QStringLiteral("soak")},
+                {QStringLiteral("cycle"), sample.cycle},
+                {QStringLiteral("started"), sample.started},
+                {QStringLiteral("transactions"), sample.transactions},
+                {QStringLiteral("objects"), sample.objects},
+                {QStringLiteral("heapKb"), sample.heap / 1024},
+                {QStringLiteral("heapGrowthBytesPerCycle"), heapGrowthPerCycle},
+                {QStringLiteral("rssKb"), sample.rss},
+                {QStringLiteral("rssGrowthKb"), sample.rss - baseline.rss}
+            };
+            out << QJsonDocument(soak).toJson(QJsonDocument::Compact) << '\n';
+        } else {
+            out << sample.cycle << '\t' << sample.started << '\t' << sample.transactions << '\t' << sample.objects << '\t' << sample.heap / 1024 << '\t'
+                << heapGrowthPerCycle << '\t' << sample.rss << '\t' << sample.rss - baseline.rss << '\n';
+        }
+        out.flush();
+    }
+
+    /*
+     * Runs @p trigger, then the event loop until @p upd emits @p signal.
+     * @return false if it didn't within s_soakStepTimeout
+     */
+    template<typename Signal, typename Trigger>
+    bool soakStep(PkUpdates *upd, Signal signal, Trigger trigger)
+    {
+        QEventLoop loop;
+        bool arrived = false;
+        QObject::connect(upd, signal, &loop, [&] {
+            arrived = true;
+            loop.quit();
+        });
+
+        trigger();
+        if (!arrived) {
+            QTimer::singleShot(s_soakStepTimeout, &loop, &QEventLoop::quit);
+            loop.exec();
+        }
+        return arrived;
+    }
+
+    /*
+     * Checks for updates, shows the details of some of them and installs them all, as a user would.
+     * @return false if a step got stuck
+     */
+    bool soakCycle(QTextStream &err, int cycle, PkUpdates *upd)
+    {
+        if (!soakStep(upd, &PkUpdates::done, [upd] { upd->checkUpdates(true /* force */, true /* manual */); })) {
+            err << "Checking for updates got stuck in cycle " << cycle << '\n';
+            return false;
+        }
+
+        // a window moving along the list, so that the details don't all come from the cache
+        const PkUpdateTable &updates = upd->updatesModel()->updates();
+        if (updates.count() > 0) {
+            const int first = (cycle * s_soakDetailCount) % updates.count();
+            const QString shown = updates.packageId(first);
+            const bool detailed = soakStep(upd, &PkUpdates::updateDetail, [upd, &updates, first, shown] {
+                for (int i = 1; i < qMin(s_soakDetailCount, updates.count()); ++i)
+                    upd->prefetchUpdateDetails(updates.packageId((first + i) % updates.count()));
+                upd->getUpdateDetails(shown);
+            });
+            if (!detailed) {
+                err << "Getting update details got stuck in cycle " << cycle << '\n';
+                return false;
+            }
+        }
+
+        if (!soakStep(upd, &PkUpdates::updatesInstalled, [upd] { upd->installUpdates(upd->updatesModel()->updates().packageIds()); })) {
+            err << "Installing updates got stuck in cycle " << cycle << '\n';
+            return false;
+        }
+        return true;
+    }
+
+    /*
+     * Runs @p cycles rounds of getting @p updates updates, fetching some of their details and
+     * installing them against replayed transactions, and reports what's left behind.
+     */
+    int soak(QTextStream &out, QTextStream &err, Format format, int cycles, int updates)
+    {
+        // started by the replay only, so neither the daemon nor the other instances of the session get involved
+        PkUpdates * upd = new PkUpdates(qApp);
+        upd->setStartupDelay(INT_MAX);
+        upd->setUpdatesChangedDelay(0);
+
+        // every other check drops half of the updates, so that the rows churn
+        FakeTransactionSource full;
+        full.generate(updates);
+        FakeTransactionSource half;
+        half.generate(updates / 2);
+
+        if (format == Tsv)
+            out << "#cycle\tstarted\ttransactions\tobjects\theap_kb\theap_growth_bytes_per_cycle\trss_kb\trss_growth_kb\n";
+
+        const int reportInterval = qMax(1, cycles / s_soakReports);
+        SoakSample baseline = {0, 0, 0, 0, 0, 0};
+        SoakSample sample = baseline;
+        bool stuck = false;
+        for (int cycle = 1; cycle <= cycles && !stuck; ++cycle) {
+            upd->setTransactionFactory(cycle % 2 ? &full : &half);
+            stuck = !soakCycle(err, cycle, upd);
+
+            // run the timers and delete whatever was left for later, as the event loop of plasmashell would
+            QCoreApplication::processEvents();
+            QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+
+            if (cycle == 1 || cycle % reportInterval == 0 || cycle == cycles || stuck) {
+                sample = soakSample(cycle, full.startedTransactions() + half.startedTransactions(), upd);
+                if (cycle == 1)
+                    baseline = sample;
+                printSoakSample(out, format, sample, baseline);
+            }
+        }
+
+        // every transaction started has to be gone by now, along with whatever was created for it
+        const bool leaking = sample.transactions > 0 || sample.objects > baseline.objects;
+        if (leaking) {
+            err << "Left behind " << sample.transactions << " of " << sample.started << " transactions and "
+                << sample.objects - baseline.objects << " objects after " << sample.cycle << " cycles\n";
+        }
+
+        delete upd;
+        return leaking || stuck ? ExitFailed : ExitOk;
+    }
+} // namespace {
 
 int main(int argc, char *argv[])
 {
+    // the fake updates of a soak run must reach neither the session nor the cache of the user, and
+    // its fake transactions no daemon, which has to be settled before anything connects to a bus
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "soak") == 0) {
+            QStandardPaths::setTestModeEnabled(true);
+            qputenv("DBUS_SESSION_BUS_ADDRESS", "disabled:");
+            qputenv("DBUS_SYSTEM_BUS_ADDRESS", "disabled:");
+            break;
+        }
+    }
+
     QApplication app(argc, argv);
     app.setOrganizationName("KDE");
     app.setOrganizationDomain("kde.org");
     app.setApplicationName("PkConsole");
     app.setApplicationVersion(PROJECT_VERSION);
 
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Checks for and installs updates using PackageKit. Prints one line per update, "
+                                                    "followed by a summary line. Exits with 0 on success, 1 on failure."));
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument(QStringLiteral("mode"),
+                                 QStringLiteral("check: refresh the repository metadata and list the updates (default)\n"
+                                                "list: list the updates, refreshing only stale metadata\n"
+                                                "install-security: install the security updates\n"
+                                                "watch: keep running and list the updates after each check\n"
+                                                "soak: replay check, detail and install rounds with the buses disabled and report the "
+                                                "transactions, objects and net heap growth left behind"),
+                                 QStringLiteral("[mode]"));
+    const QCommandLineOption formatOption(QStringLiteral("format"), QStringLiteral("Output format, tsv (default) or json."),
+                                          QStringLiteral("format"), QStringLiteral("tsv"));
+    const QCommandLineOption maxAgeOption(QStringLiteral("max-age"),
+                                          QStringLiteral("Maximum age of the repository metadata in seconds (default: a day)."),
+                                          QStringLiteral("seconds"), QStringLiteral("86400"));
+    const QCommandLineOption timeoutOption(QStringLiteral("timeout"),
+                                           QStringLiteral("Give up after this many seconds, 0 for never "
+                                                          "(default: an hour, never for watch and soak)."),
+                                           QStringLiteral("seconds"), QStringLiteral("3600"));
+    const QCommandLineOption timingsOption(QStringLiteral("record-timings"),
+                                           QStringLiteral("Append the duration of each phase to the stats file in the cache directory."));
+    const QCommandLineOption cyclesOption(QStringLiteral("cycles"), QStringLiteral("Rounds of a soak run (default: 1000)."),
+                                          QStringLiteral("count"), QStringLiteral("1000"));
+    const QCommandLineOption updatesOption(QStringLiteral("updates"), QStringLiteral("Updates replayed per round of a soak run (default: 1000)."),
+                                           QStringLiteral("count"), QStringLiteral("1000"));
+    parser.addOption(formatOption);
+    parser.addOption(maxAgeOption);
+    parser.addOption(timeoutOption);
+    parser.addOption(timingsOption);
+    parser.addOption(cyclesOption);
+    parser.addOption(updatesOption);
+    parser.process(app);
+
+    QTextStream err(stderr);
+    const QString mode = parser.positionalArguments().value(0, QStringLiteral("check"));
+    if (mode != QLatin1String("check") && mode != QLatin1String("list") && mode != QLatin1String("install-security")
+            && mode != QLatin1String("watch") && mode != QLatin1String("soak")) {
+        err << "Unknown mode: " << mode << '\n';
+        return ExitUsage;
+    }
+
+    const QString formatName = parser.value(formatOption);
+    if (formatName != QLatin1String("tsv") && formatName != QLatin1String("json")) {
+        err << "Unknown format: " << formatName << '\n';
+        return ExitUsage;
+    }
+    const Format format = formatName == QLatin1String("json") ? Json : Tsv;
+
+    bool ok;
+    const qint64 maxAge = parser.value(maxAgeOption).toLongLong(&ok);
+    if (!ok || maxAge < 0) {
+        err << "Invalid maximum age: " << parser.value(maxAgeOption) << '\n';
+        return ExitUsage;
+    }
+    const int timeout = parser.value(timeoutOption).toInt(&ok);
+    if (!ok || timeout < 0) {
+        err << "Invalid timeout: " << parser.value(timeoutOption) << '\n';
+        return ExitUsage;
+    }
+
+    // watch keeps running and a soak run takes as long as its cycles do, the default only bounds the other modes
+    const bool bounded = parser.isSet(timeoutOption) || (mode != QLatin1String("watch") && mode != QLatin1String("soak"));
+    if (timeout > 0 && bounded) {
+        QTimer::singleShot(timeout * 1000, &app, [&err] {
+            err << "Timed out\n";
+            QCoreApplication::exit(ExitFailed);
+        });
+    }
+
+    QTextStream out(stdout);
+    if (mode == QLatin1String("soak")) {
+        const int cycles = parser.value(cyclesOption).toInt(&ok);
+        if (!ok || cycles < 1) {
+            err << "Invalid number of cycles: " << parser.value(cyclesOption) << '\n';
+            return ExitUsage;
+        }
+        const int updates = parser.value(updatesOption).toInt(&ok);
+        if (!ok || updates < 1) {
+            err << "Invalid number of updates: " << parser.value(updatesOption) << '\n';
+            return ExitUsage;
+        }
+        return soak(out, err, format, cycles, updates);
+    }
+
     PkUpdates * upd = new PkUpdates(qApp);
-    QObject::connect(upd, &PkUpdates::done, qApp, &QCoreApplication::quit);
+    upd->setRecordTimings(parser.isSet(timingsOption));
+    bool installing = false;
+
+    // stream the updates as the daemon reports them
+    QSet<QString> printed;
+    QObject::connect(upd, &PkUpdates::updateFound, [&] (const QString &packageID, const QString &summary, int severity) {
+        if (!printed.contains(packageID)) {
+            printed.insert(packageID);
+            printUpdate(out, format, packageID, summary, severity);
+        }
+    });
+
+    // updates published by the session's leader don't get streamed, print whatever is missing
+    auto printRemaining = [&] {
+        const PkUpdateTable &updates = upd->updatesModel()->updates();
+        for (int row = 0; row < updates.count(); ++row) {
+            if (!printed.contains(updates.packageId(row)))
+                printUpdate(out, format, updates.packageId(row), updates.summary(row), updates.severity(row));
+        }
+        printed.clear();
+    };
+
+    QObject::connect(upd, &PkUpdates::done, [&] {
+        // checks a failed installation triggers, or publications of the session's leader
+        if (installing)
+            return;
+
+        printRemaining();
+        printSummary(out, format, QStringLiteral("summary"), upd);
+        if (mode == QLatin1String("watch"))
+            return;
+
+        if (mode == QLatin1String("install-security") && upd->lastCheckSuccessful() && upd->securityCount() > 0) {
+            const PkUpdateTable &updates = upd->updatesModel()->updates();
+            QStringList packageIds;
+            for (int row : updates.rowsOfSeverity(PkUpdateTable::SecuritySeverity))
+                packageIds << updates.packageId(row);
+            installing = true;
+            upd->installUpdatesStaged(packageIds);
+            return;
+        }
+
+        QCoreApplication::exit(upd->lastCheckSuccessful() ? ExitOk : ExitFailed);
+    });
+
+    QObject::connect(upd, &PkUpdates::updatesInstalled, [&] {
+        printSummary(out, format, QStringLiteral("installed"), upd);
+        QCoreApplication::exit(ExitOk);
+    });
+
+    QObject::connect(upd, &PkUpdates::installFailed, [&] {
+        if (!installing)
+            return;
+        printSummary(out, format, QStringLiteral("install-failed"), upd);
+        QCoreApplication::exit(ExitFailed);
+    });
+
+    // nobody to agree to it
+    QObject::connect(upd, &PkUpdates::eulaRequired, [&] (const QString &eulaID, const QString &packageID) {
+        err << "Declining the license agreement " << eulaID << " required by " << packageID << '\n';
+        err.flush();
+        upd->eulaAgreementResult(eulaID, false);
+    });
+
+    if (mode == QLatin1String("check")) {
+        upd->checkUpdates(true /* force */, false /* manual */);
+    } else {
+        if (mode == QLatin1String("watch"))
+            upd->setCheckInterval(int(qMin<qint64>(maxAge, INT_MAX)));
+        upd->checkUpdatesIfNeeded(maxAge, false /* manual */);
+    }
 
     return app.exec();
 }
@@ -0,0 +1,172 @@
+/***************************************************************************
+ *   Copyright (C) 2026 agent <agent@local>                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; see the file COPYING. If not, write to       *
+ *   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,  *
+ *   Boston, MA 02110-1301, USA.                                           *
+ ***************************************************************************/
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QTimer>
+
+#include "phasetimings.h"
+#include "pkupdates.h"
+
+namespace
+{
+    // the stats file is rotated once it gets bigger than this
+    const qint64 s_maxStatsSize = 1024 * 1024;
+    // how long the rows of the stats file get collected before being written
+    const int s_flushDelay = 10 * 1000; // ms
+
+    const char * const s_phaseNames[PhaseTimings::PhaseCount] = {
+        "trigger",
+        "queueWait",
+        "refresh",
+        "getUpdates",
+        "simulate",
+        "download",
+        "install"
+    };
+} // namespace {
+
+PhaseTimings::PhaseTimings(QObject *parent) :
+    QObject(parent),
+    m_flushTimer(new QTimer(this))
+{
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(s_flushDelay);
+    connect(m_flushTimer, &QTimer::timeout, this, &PhaseTimings::flush);
+}
+
+PhaseTimings::~PhaseTimings()
+{
+    flush();
+}
+
+void PhaseTimings::begin(Phase phase)
+{
+    m_timers[phase].start();
+}
+
+void PhaseTimings::end(Phase phase, bool success, int items)
+{
+    if (!m_timers[phase].isValid())
+        return;
+
+    const qint64 msecs = m_timers[phase].elapsed();
+    m_timers[phase].invalidate();
+    record(phase, msecs, success, items);
+}
+
+void PhaseTimings::record(Phase phase, qint64 msecs, bool success, int items)
+{
+    Measurement &measurement = m_measurements[phase];
+    measurement.msecs = msecs;
+    measurement.items = items;
+    measurement.success = success;
+    measurement.finished = QDateTime::currentDateTime();
+
+    qCDebug(PLASMA_PK_UPDATES) << "Phase" << s_phaseNames[phase] << "took" << msecs << "ms, items:" << items << ", success:" << success;
+    if (m_recording)
+        append(phase, measurement);
+    emit changed();
+}
+
+bool PhaseTimings::isRunning(Phase phase) const
+{
+    return m_timers[phase].isValid();
+}
+
+QVariantMap PhaseTimings::toMap() const
+{
+    QVariantMap result;
+    for (int phase = 0; phase < PhaseCount; ++phase) {
+        const Measurement &measurement = m_measurements[phase];
+        if (measurement.msecs < 0)
+            continue;
+
+        QVariantMap entry {
+            {QStringLiteral("msecs"), measurement.msecs},
+            {QStringLiteral("success"), measurement.success},
+            {QStringLiteral("finished"), measurement.finished}
+        };
+        if (measurement.items >= 0) {
+            entry.insert(QStringLiteral("items"), measurement.items);
+            if (measurement.msecs > 0)
+                entry.insert(QStringLiteral("itemsPerSecond"), measurement.items * 1000.0 / measurement.msecs);
+        }
+        result.insert(QString::fromLatin1(s_phaseNames[phase]), entry);
+    }
+    return result;
+}
+
+bool PhaseTimings::isRecording() const
+{
+    return m_recording;
+}
+
+void PhaseTimings::setRecording(bool recording)
+{
+    m_recording = recording;
+    if (!m_recording)
+        flush();
+}
+
+QString PhaseTimings::statsFilePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) +
+            QStringLiteral("/plasma-pk-updates/timings.log");
+}
+
+void PhaseTimings::append(Phase phase, const Measurement &measurement)
+{
+    // finished, phase, duration, items, success
+    m_pendingRows << QStringLiteral("%1\t%2\t%3\t%4\t%5\n").arg(measurement.finished.toString(Qt::ISODate), QString::fromLatin1(s_phaseNames[phase]))
+                     .arg(measurement.msecs).arg(measurement.items).arg(measurement.success ? 1 : 0);
+    if (!m_flushTimer->isActive())
+        m_flushTimer->start();
+}
+
+void PhaseTimings::flush()
+{
+    m_flushTimer->stop();
+    if (m_pendingRows.isEmpty())
+        return;
+
+    const QString path = statsFilePath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    if (QFileInfo(path).size() > s_maxStatsSize) {
+        const QString rotated = path + QStringLiteral(".1");
+        QFile::remove(rotated);
+        QFile::rename(path, rotated);
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        qCWarning(PLASMA_PK_UPDATES) << "Failed to open the stats file" << path << file.errorString();
+        m_pendingRows.clear();
+        return;
+    }
+
+    QTextStream stream(&file);
+    for (const QString &row : m_pendingRows)
+        stream << row;
+    m_pendingRows.clear();
+}
@@ -0,0 +1,123 @@
+/***************************************************************************
+ *   Copyright (C) 2026 agent <agent@local>                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; see the file COPYING. If not, write to       *
+ *   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,  *
+ *   Boston, MA 02110-1301, USA.                                           *
+ ***************************************************************************/
+
+#ifndef PLASMA_PK_PHASE_TIMINGS_H
+#define PLASMA_PK_PHASE_TIMINGS_H
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QStringList>
+#include <QVariantMap>
+
+class QTimer;
+
+/**
+ * @brief The PhaseTimings class
+ *
+ * Measures how long each phase of checking for and installing updates
+ * takes, from the trigger of a check to the end of the installation. The
+ * last measurement of each phase is available as a QVariantMap; each one
+ * can also be appended to a rolling stats file in the cache directory. The
+ * rows are written in batches, a while after the first of them was recorded,
+ * so that the end of a phase doesn't wait for the disk.
+ */
+class PhaseTimings : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Phase {
+        Trigger = 0,  ///< from asking for a check to the refresh transaction starting
+        QueueWait,    ///< time a transaction spent waiting for the daemon (StatusWait)
+        Refresh,
+        GetUpdates,
+        Simulate,
+        Download,
+        Install,
+        PhaseCount
+    };
+
+    explicit PhaseTimings(QObject *parent = nullptr);
+    ~PhaseTimings();
+
+    /**
+     * Start measuring @p phase, restarting it if already running
+     */
+    void begin(Phase phase);
+
+    /**
+     * Stop measuring @p phase and record the result, if it was started
+     * @param items the number of items processed during the phase, -1 if not applicable
+     */
+    void end(Phase phase, bool success, int items = -1);
+
+    /**
+     * Record a phase that was measured elsewhere
+     */
+    void record(Phase phase, qint64 msecs, bool success, int items = -1);
+
+    /**
+     * @return whether @p phase is being measured
+     */
+    bool isRunning(Phase phase) const;
+
+    /**
+     * @return the last measurement of each phase, keyed by the phase name
+     */
+    QVariantMap toMap() const;
+
+    /**
+     * @return whether the measurements are appended to the stats file
+     */
+    bool isRecording() const;
+    void setRecording(bool recording);
+
+    /**
+     * @return the path of the stats file
+     */
+    static QString statsFilePath();
+
+    /**
+     * Write the measurements recorded since the last flush to the stats file
+     */
+    void flush();
+
+signals:
+    void changed();
+
+private:
+    struct Measurement {
+        qint64 msecs = -1;
+        int items = -1;
+        bool success = false;
+        QDateTime finished;
+    };
+
+    void append(Phase phase, const Measurement &measurement);
+
+    QElapsedTimer m_timers[PhaseCount];
+    Measurement m_measurements[PhaseCount];
+    bool m_recording = false;
+    // rows of the stats file not written yet, and the timer writing them
+    QStringList m_pendingRows;
+    QTimer * m_flushTimer;
+};
+
+#endif // PLASMA_PK_PHASE_TIMINGS_H
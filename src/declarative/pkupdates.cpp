@@ -17,67 +17,213 @@
  *   Boston, MA 02110-1301, USA.                                           *
  ***************************************************************************/
 
+#include <algorithm>
 #include <limits.h>
 
 #include <QDebug>
 #include <QTimer>
-#include <QDBusReply>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
 #include <QDBusInterface>
+#include <QDBusReply>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
 
 #include <KLocalizedString>
 #include <KFormat>
-#include <KNotification>
 #include <Solid/Power>
 #include <Solid/AcPluggedJob>
 #include <KConfigGroup>
 #include <KSharedConfig>
+#include <PackageKit/Offline>
 
 #include "pkupdates.h"
+#include "pkupdatesmodel.h"
+#include "phasetimings.h"
+#include "transactionfactory.h"
+#include "transactionqueue.h"
+#include "updatenotifier.h"
+#include "updatesbroker.h"
+#include "updatescheduler.h"
 #include "PkStrings.h"
 
 Q_LOGGING_CATEGORY(PLASMA_PK_UPDATES, "plasma-pk-updates")
 
 namespace
 {
-    const auto s_pkUpdatesIconName = QStringLiteral("system-software-update");
-    const auto s_componentName = QStringLiteral("plasma_pk_updates");
-    const auto s_eventIdUpdatesAvailable = QStringLiteral("updatesAvailable");
-    const auto s_eventIdUpdatesInstalled = QStringLiteral("updatesInstalled");
-    const auto s_eventIdRestartRequired = QStringLiteral("restartRequired");
-    const auto s_eventIdError = QStringLiteral("updateError");
+    const int s_defaultStartupDelay = 30 * 1000; // ms, the default of the startup_delay setting
+    const int s_defaultUpdatesChangedDelay = 1000; // ms
+    const int s_progressInterval = 100; // ms
+    const int s_configSyncDelay = 5000; // ms
+    const int s_stagedBatchSize = 100;
+    const int s_detailsBatchDelay = 100; // ms
+    const int s_detailsBatchSize = 50;
+    const int s_defaultDetailsCacheSize = 4 * 1024 * 1024; // bytes
+    const int s_compressedChangelogSize = 16 * 1024; // characters
+    const int s_detailsReleaseDelay = 5 * 60 * 1000; // ms
+    const int s_publishInterval = 100; // ms
+    const int s_publishBatchSize = 500;
+    const quint32 s_cacheMagic = 0x504b5550; // "PKUP"
+    const quint32 s_cacheVersion = 2;
+
+    QString cacheFilePath()
+    {
+        return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) +
+                QStringLiteral("/plasma-pk-updates/updates.cache");
+    }
 } // namespace {
 
 PkUpdates::PkUpdates(QObject *parent) :
     QObject(parent),
+    m_daemonTransactions(new TransactionFactory(this)),
+    m_config(KSharedConfig::openConfig("plasma-pk-updates")),
+    m_configSyncTimer(new QTimer(this)),
+    m_startupTimer(new QTimer(this)),
+    m_updatesModel(new PkUpdatesModel(this)),
+    m_publishTimer(new QTimer(this)),
+    m_getUpdatesTimer(new QTimer(this)),
+    m_scheduler(new UpdateScheduler(m_config, this)),
+    m_queue(new TransactionQueue(this)),
+    m_timings(new PhaseTimings(this)),
+    m_notifier(new UpdateNotifier(this)),
+    m_detailsTimer(new QTimer(this)),
+    m_detailsReleaseTimer(new QTimer(this)),
+    m_progressTimer(new QTimer(this)),
     m_isOnBattery(true)
 {
     setStatusMessage(i18n("Idle"));
 
+    loadRefreshState();
+    m_configSyncTimer->setSingleShot(true);
+    m_configSyncTimer->setInterval(s_configSyncDelay);
+    connect(m_configSyncTimer, &QTimer::timeout, this, &PkUpdates::syncConfig);
+    connect(m_scheduler, &UpdateScheduler::configChanged, this, &PkUpdates::scheduleConfigSync);
+
+    m_publishTimer->setSingleShot(true);
+    m_publishTimer->setInterval(s_publishInterval);
+    connect(m_publishTimer, &QTimer::timeout, this, &PkUpdates::publishPendingUpdates);
+
+    m_getUpdatesTimer->setSingleShot(true);
+    m_getUpdatesTimer->setInterval(s_defaultUpdatesChangedDelay);
+    connect(m_getUpdatesTimer, &QTimer::timeout, this, &PkUpdates::getUpdates);
+
+    m_detailsTimer->setSingleShot(true);
+    m_detailsTimer->setInterval(s_detailsBatchDelay);
+    connect(m_detailsTimer, &QTimer::timeout, this, &PkUpdates::fetchUpdateDetails);
+
+    m_updateDetails.setMaxCost(s_defaultDetailsCacheSize);
+    m_detailsReleaseTimer->setSingleShot(true);
+    m_detailsReleaseTimer->setInterval(s_detailsReleaseDelay);
+    connect(m_detailsReleaseTimer, &QTimer::timeout, this, [this] {
+        qCDebug(PLASMA_PK_UPDATES) << "Details not shown for a while, releasing" << m_updateDetails.totalCost() << "bytes";
+        m_updateDetails.clear();
+    });
+
+    m_progressTimer->setSingleShot(true);
+    m_progressTimer->setInterval(s_progressInterval);
+    connect(m_progressTimer, &QTimer::timeout, this, &PkUpdates::onProgressTimeout);
+
+    connect(m_queue, &TransactionQueue::depthChanged, this, &PkUpdates::queueDepthChanged);
+    connect(m_timings, &PhaseTimings::changed, this, &PkUpdates::phaseTimingsChanged);
+    connect(m_notifier, &UpdateNotifier::restartActivated, this, &PkUpdates::restart);
+
+    connect(this, &PkUpdates::done, this, [this] {
+        if (!isLeader())
+            return;
+        // the subscribers read the timestamp from the file
+        if (m_configSyncTimer->isActive())
+            syncConfig();
+        m_broker->publish(m_updatesModel->updates(), m_lastCheckSuccessful);
+    });
+
+    // show the result of the last check right away, it gets revalidated against the daemon once we're activated
+    if (loadCache())
+        m_lastCheckSuccessful = true;
+    updateUrgency();
+    connect(this, &PkUpdates::updatesChanged, this, &PkUpdates::updateUrgency);
+
+    // keep plasmashell startup free of D-Bus round trips, the daemon gets activated later
+    m_startupTimer->setSingleShot(true);
+    m_startupTimer->setInterval(s_defaultStartupDelay);
+    connect(m_startupTimer, &QTimer::timeout, this, &PkUpdates::activate);
+    m_startupTimer->start();
+
+    connect(this, &PkUpdates::networkStateChanged, this, &PkUpdates::doDelayedCheckUpdates);
+    connect(this, &PkUpdates::isActiveChanged, this, &PkUpdates::messageChanged);
+    connect(this, &PkUpdates::networkStateChanged, this, &PkUpdates::messageChanged);
+
+    connect(m_scheduler, &UpdateScheduler::checkDue, this, &PkUpdates::onCheckDue);
+    connect(this, &PkUpdates::checkAllowedChanged, this, &PkUpdates::onCheckDue);
+    connect(this, &PkUpdates::done, m_scheduler, &UpdateScheduler::reschedule);
+}
+
+void PkUpdates::activate()
+{
+    if (m_activated)
+        return;
+
+    qCDebug(PLASMA_PK_UPDATES) << "Activating";
+    m_activated = true;
+    m_startupTimer->stop();
+
+    // only the leader of the session talks to the daemon about updates, the others get them pushed
+    m_broker = new UpdatesBroker(this);
+    connect(m_broker, &UpdatesBroker::leaderChanged, this, &PkUpdates::onLeaderChanged);
+    connect(m_broker, &UpdatesBroker::updatesReceived, this, &PkUpdates::onBrokerUpdates);
+    connect(m_broker, &UpdatesBroker::publicationReceived, this, &PkUpdates::onBrokerPublication);
+    connect(m_broker, &UpdatesBroker::statusReceived, this, &PkUpdates::onBrokerStatus);
+    connect(m_broker, &UpdatesBroker::checkRequested, this, &PkUpdates::checkUpdates);
+    connect(m_broker, &UpdatesBroker::checkFailed, this, &PkUpdates::onBrokerCheckFailed);
+    if (!m_broker->isLeader())
+        return;
+
+    connectDaemon();
+    if (m_lastCheckSuccessful)
+        scheduleGetUpdates();
+    onCheckDue();
+}
+
+void PkUpdates::connectDaemon()
+{
+    if (m_daemonConnected)
+        return;
+
+    m_daemonConnected = true;
+    // replayed transactions have neither a daemon nor a machine behind them to follow
+    if (!transactions()->isDaemon()) {
+        onNetworkStateChanged();
+        updateCheckAllowed();
+        publishStatus();
+        return;
+    }
+
     connect(PackageKit::Daemon::global(), &PackageKit::Daemon::changed, this, &PkUpdates::onChanged);
     connect(PackageKit::Daemon::global(), &PackageKit::Daemon::updatesChanged, this, &PkUpdates::onUpdatesChanged);
-    connect(PackageKit::Daemon::global(), &PackageKit::Daemon::networkStateChanged, this, &PkUpdates::networkStateChanged);
+    connect(PackageKit::Daemon::global(), &PackageKit::Daemon::networkStateChanged, this, &PkUpdates::onNetworkStateChanged);
+    onNetworkStateChanged();
+    updateCheckAllowed();
+    connect(PackageKit::Daemon::offline(), &PackageKit::Offline::changed, this, &PkUpdates::onOfflineChanged);
+    onOfflineChanged();
     connect(Solid::Power::self(), &Solid::Power::resumeFromSuspend, this,
             [this] {PackageKit::Daemon::stateHasChanged(QStringLiteral("resume"));});
 
     connect(Solid::Power::self(), &Solid::Power::acPluggedChanged, this, [this] (bool acPlugged) {
             qCDebug(PLASMA_PK_UPDATES) << "acPluggedChanged onBattery:" << m_isOnBattery << "->" << !acPlugged;
-            if (!acPlugged != m_isOnBattery) {
-                m_isOnBattery = !acPlugged;
-                emit PkUpdates::isOnBatteryChanged();
-            }
+            setOnBattery(!acPlugged);
     });
     auto acPluggedJob = Solid::Power::self()->isAcPlugged(this);
     connect(acPluggedJob , &Solid::Job::result, this, [this] (Solid::Job* job) {
         bool acPlugged = static_cast<Solid::AcPluggedJob*>(job)->isPlugged();
         qCDebug(PLASMA_PK_UPDATES) << "acPlugged initial state" << acPlugged;
-        m_isOnBattery = !acPlugged;
-        emit PkUpdates::isOnBatteryChanged();
+        setOnBattery(!acPlugged);
     });
     acPluggedJob->start();
 
-    connect(PackageKit::Daemon::global(), &PackageKit::Daemon::networkStateChanged, this, &PkUpdates::doDelayedCheckUpdates);
-    connect(this, &PkUpdates::isActiveChanged, this, &PkUpdates::messageChanged);
-    connect(this, &PkUpdates::networkStateChanged, this, &PkUpdates::messageChanged);
+    // the state read before might not have changed from what the previous leader shared
+    publishStatus();
 }
 
 PkUpdates::~PkUpdates()
@@ -95,29 +241,41 @@ PkUpdates::~PkUpdates()
     if (m_installTrans) {
         m_installTrans->deleteLater();
     }
-    if (m_detailTrans) {
-        m_detailTrans->deleteLater();
+    if (m_downloadTrans) {
+        if (m_downloadTrans->allowCancel())
+            m_downloadTrans->cancel();
+        m_downloadTrans->deleteLater();
+    }
+    if (m_prepareTrans) {
+        if (m_prepareTrans->allowCancel())
+            m_prepareTrans->cancel();
+        m_prepareTrans->deleteLater();
+    }
+    if (m_eulaTrans) {
+        m_eulaTrans->deleteLater();
     }
+    if (m_configSyncTimer->isActive())
+        syncConfig();
 }
 
 int PkUpdates::count() const
 {
-    return m_updateList.count();
+    return m_updatesModel->count();
 }
 
 int PkUpdates::importantCount() const
 {
-    return m_importantList.count();
+    return m_updatesModel->updates().severityCount(PkUpdateTable::ImportantSeverity);
 }
 
 int PkUpdates::securityCount() const
 {
-    return m_securityList.count();
+    return m_updatesModel->updates().severityCount(PkUpdateTable::SecuritySeverity);
 }
 
 bool PkUpdates::isSystemUpToDate() const
 {
-    return m_updateList.isEmpty();
+    return m_updatesModel->count() == 0;
 }
 
 QString PkUpdates::iconName() const
@@ -142,6 +300,8 @@ QString PkUpdates::message() const
             return i18n("Getting updates");
         else if (m_activity == InstallingUpdates)
             return i18n("Installing updates");
+        else if (m_activity == PreparingUpdates)
+            return i18n("Preparing updates");
 
         return i18n("Working");
     } else if (!isSystemUpToDate()) {
@@ -180,15 +340,19 @@ bool PkUpdates::isActive() const
     return m_activity != Idle;
 }
 
-QVariantMap PkUpdates::packages() const
+bool PkUpdates::isGettingUpdates() const
 {
-    return m_updateList;
+    return m_activity == GettingUpdates;
+}
+
+PkUpdatesModel * PkUpdates::updatesModel() const
+{
+    return m_updatesModel;
 }
 
 bool PkUpdates::isNetworkOnline() const
 {
-    qCDebug(PLASMA_PK_UPDATES) << "Is net online:" << (PackageKit::Daemon::networkState() > PackageKit::Daemon::Network::NetworkOffline);
-    return (PackageKit::Daemon::networkState() > PackageKit::Daemon::Network::NetworkOffline);
+    return m_networkState > PackageKit::Daemon::Network::NetworkOffline;
 }
 
 void PkUpdates::doDelayedCheckUpdates()
@@ -203,403 +367,1457 @@ void PkUpdates::doDelayedCheckUpdates()
 
 bool PkUpdates::isNetworkMobile() const
 {
-    qCDebug(PLASMA_PK_UPDATES) << "Is net mobile:" << (PackageKit::Daemon::networkState() == PackageKit::Daemon::Network::NetworkMobile);
-    return (PackageKit::Daemon::networkState() == PackageKit::Daemon::Network::NetworkMobile);
+    return m_networkState == PackageKit::Daemon::Network::NetworkMobile;
 }
 
 bool PkUpdates::isOnBattery() const
 {
-    qCDebug(PLASMA_PK_UPDATES) << "Is on battery:" << m_isOnBattery;
     return m_isOnBattery;
 }
 
-void PkUpdates::getUpdateDetails(const QString &pkgID)
+bool PkUpdates::checkAllowed() const
 {
-    qCDebug(PLASMA_PK_UPDATES) << "Requesting update details for" << pkgID;
-    m_detailTrans = PackageKit::Daemon::getUpdateDetail(pkgID);
-    connect(m_detailTrans.data(), &PackageKit::Transaction::updateDetail, this, &PkUpdates::onUpdateDetail);
+    return m_checkAllowed;
 }
 
-QString PkUpdates::timestamp() const
+void PkUpdates::onNetworkStateChanged()
 {
-    const qint64 lastCheck = QDateTime::currentMSecsSinceEpoch() - lastRefreshTimestamp();
+    setNetworkState(transactions()->networkState());
+}
 
-    if (lastCheck != -1)
-        return i18n("Last check: %1 ago", KFormat().formatSpelloutDuration(lastCheck));
+void PkUpdates::setNetworkState(PackageKit::Daemon::Network state)
+{
+    if (state == m_networkState)
+        return;
 
-    return i18n("Last check: never");
+    qCDebug(PLASMA_PK_UPDATES) << "Network state changed:" << m_networkState << "->" << state;
+    m_networkState = state;
+    publishStatus();
+    updateCheckAllowed();
+    emit networkStateChanged();
 }
 
-void PkUpdates::checkUpdates(bool force, bool manual)
+void PkUpdates::publishStatus()
 {
-    m_isManualCheck = manual;
-
-    if (!isNetworkOnline())
-    {
-        qCDebug(PLASMA_PK_UPDATES) << "Checking updates delayed. Network is offline";
-        m_checkUpdatesWhenNetworkOnline = true;
+    if (!isLeader())
         return;
-    }
-    qCDebug(PLASMA_PK_UPDATES) << "Checking updates, forced";
 
-    // ask the Packagekit daemon to refresh the cache
-    m_cacheTrans = PackageKit::Daemon::refreshCache(force);
-    setActivity(CheckingUpdates);
-
-    // evaluate the result
-    connect(m_cacheTrans.data(), &PackageKit::Transaction::statusChanged, this, &PkUpdates::onStatusChanged);
-    connect(m_cacheTrans.data(), &PackageKit::Transaction::finished, this, &PkUpdates::onFinished);
-    connect(m_cacheTrans.data(), &PackageKit::Transaction::errorCode, this, &PkUpdates::onRefreshErrorCode);
-    connect(m_cacheTrans.data(), &PackageKit::Transaction::requireRestart, this, &PkUpdates::onRequireRestart);
-    connect(m_cacheTrans.data(), &PackageKit::Transaction::repoSignatureRequired, this, &PkUpdates::onRepoSignatureRequired);
+    // a check of a subscriber would wait for the network without it hearing back, reject it instead
+    m_broker->setCanCheck(isNetworkOnline());
+    m_broker->publishStatus(m_networkState, m_updatePrepared);
 }
 
-qint64 PkUpdates::lastRefreshTimestamp() const
+void PkUpdates::setOnBattery(bool onBattery)
 {
-    KConfigGroup grp(KSharedConfig::openConfig("plasma-pk-updates"), "General");
-    return grp.readEntry<qint64>("Timestamp", -1);
+    if (onBattery == m_isOnBattery)
+        return;
+
+    m_isOnBattery = onBattery;
+    updateCheckAllowed();
+    emit isOnBatteryChanged();
 }
 
-QString PkUpdates::packageName(const QString &pkgId)
+void PkUpdates::updateCheckAllowed()
 {
-    return PackageKit::Daemon::packageName(pkgId);
+    const bool allowed = backgroundNetworkAllowed();
+    if (allowed != m_checkAllowed) {
+        qCDebug(PLASMA_PK_UPDATES) << "Background checks allowed:" << allowed;
+        m_checkAllowed = allowed;
+        emit checkAllowedChanged();
+    }
 }
 
-QString PkUpdates::packageVersion(const QString &pkgId)
+int PkUpdates::startupDelay() const
 {
-    return PackageKit::Daemon::packageVersion(pkgId);
+    return m_startupTimer->interval();
 }
 
-void PkUpdates::getUpdates()
+void PkUpdates::setStartupDelay(int delay)
 {
-    m_updatesTrans = PackageKit::Daemon::getUpdates();
-    setActivity(GettingUpdates);
-
-    m_updateList.clear();
-    m_importantList.clear();
-    m_securityList.clear();
-
-    connect(m_updatesTrans.data(), &PackageKit::Transaction::statusChanged, this, &PkUpdates::onStatusChanged);
-    connect(m_updatesTrans.data(), &PackageKit::Transaction::finished, this, &PkUpdates::onFinished);
-    connect(m_updatesTrans.data(), &PackageKit::Transaction::errorCode, this, &PkUpdates::onErrorCode);
-    connect(m_updatesTrans.data(), &PackageKit::Transaction::package, this, &PkUpdates::onPackage);
-    connect(m_updatesTrans.data(), &PackageKit::Transaction::requireRestart, this, &PkUpdates::onRequireRestart);
-    connect(m_updatesTrans.data(), &PackageKit::Transaction::repoSignatureRequired, this, &PkUpdates::onRepoSignatureRequired);
+    delay = qMax(0, delay);
+    if (delay != m_startupTimer->interval()) {
+        m_startupTimer->setInterval(delay);
+        if (!m_activated)
+            m_startupTimer->start();
+        emit startupDelayChanged();
+    }
 }
 
-void PkUpdates::installUpdates(const QStringList &packageIds, bool simulate, bool untrusted)
+int PkUpdates::updatesChangedDelay() const
 {
-    qCDebug(PLASMA_PK_UPDATES) << "Installing updates" << packageIds << ", simulate:" << simulate << ", untrusted:" << untrusted;
+    return m_getUpdatesTimer->interval();
+}
 
-    PackageKit::Transaction::TransactionFlags flags = PackageKit::Transaction::TransactionFlagOnlyTrusted;
-    if (simulate) {
-        flags |= PackageKit::Transaction::TransactionFlagSimulate;
-    } else if (untrusted) {
-        flags = PackageKit::Transaction::TransactionFlagNone;
+void PkUpdates::setUpdatesChangedDelay(int delay)
+{
+    delay = qMax(0, delay);
+    if (delay != m_getUpdatesTimer->interval()) {
+        m_getUpdatesTimer->setInterval(delay);
+        emit updatesChangedDelayChanged();
     }
+}
 
-    m_requiredEulas.clear();
-    m_packages = packageIds;
-    m_installTrans = PackageKit::Daemon::updatePackages(m_packages, flags);
-    setActivity(InstallingUpdates);
-
-    connect(m_installTrans.data(), &PackageKit::Transaction::statusChanged, this, &PkUpdates::onStatusChanged);
-    connect(m_installTrans.data(), &PackageKit::Transaction::finished, this, &PkUpdates::onFinished);
-    connect(m_installTrans.data(), &PackageKit::Transaction::errorCode, this, &PkUpdates::onErrorCode);
-    connect(m_installTrans.data(), &PackageKit::Transaction::package, this, &PkUpdates::onPackageUpdating);
-    connect(m_installTrans.data(), &PackageKit::Transaction::requireRestart, this, &PkUpdates::onRequireRestart);
-    connect(m_installTrans.data(), &PackageKit::Transaction::repoSignatureRequired, this, &PkUpdates::onRepoSignatureRequired);
-    connect(m_installTrans.data(), &PackageKit::Transaction::eulaRequired, this, &PkUpdates::onEulaRequired);
+int PkUpdates::checkInterval() const
+{
+    return m_scheduler->interval();
 }
 
-void PkUpdates::onChanged()
+void PkUpdates::setCheckInterval(int interval)
 {
-    qCDebug(PLASMA_PK_UPDATES) << "Daemon changed";
+    if (interval != m_scheduler->interval()) {
+        m_scheduler->setInterval(interval);
+        emit checkIntervalChanged();
+    }
 }
 
-void PkUpdates::onUpdatesChanged()
+bool PkUpdates::checkOnMobile() const
 {
-    qCDebug(PLASMA_PK_UPDATES) << "Updates changed, getting updates!";
-    getUpdates();
+    return m_checkOnMobile;
 }
 
-void PkUpdates::onStatusChanged()
+void PkUpdates::setCheckOnMobile(bool allowed)
 {
-    PackageKit::Transaction * trans;
-    if ((trans = qobject_cast<PackageKit::Transaction *>(sender()))) {
-        qCDebug(PLASMA_PK_UPDATES) << "Transaction status changed:"
-                 << PackageKit::Daemon::enumToString<PackageKit::Transaction>((int)trans->status(), "Status")
-                 << QStringLiteral("(%1%)").arg(trans->percentage());
-        if (trans->status() == PackageKit::Transaction::StatusFinished)
-            return;
-        setStatusMessage(PkStrings::status(trans->status(), trans->speed(), trans->downloadSizeRemaining()));
-        setPercentage(trans->percentage());
+    if (allowed != m_checkOnMobile) {
+        m_checkOnMobile = allowed;
+        updateCheckAllowed();
+        emit checkOnMobileChanged();
     }
 }
 
-void PkUpdates::onPackage(PackageKit::Transaction::Info info, const QString &packageID, const QString &summary)
+bool PkUpdates::checkOnBattery() const
 {
-    qCDebug(PLASMA_PK_UPDATES) << "Got update package:" << packageID << ", summary:" << summary <<
-                ", type:" << PackageKit::Daemon::enumToString<PackageKit::Transaction>((int)info, "Info");
+    return m_checkOnBattery;
+}
 
-    switch (info) {
-    case PackageKit::Transaction::InfoBlocked:
-        // Blocked updates are not installable updates so there is no
-        // reason to show/count them
-        return;
-    case PackageKit::Transaction::InfoImportant:
-        m_importantList << packageID;
-        break;
-    case PackageKit::Transaction::InfoSecurity:
-        m_securityList << packageID;
-        break;
-    default:
-        break;
+void PkUpdates::setCheckOnBattery(bool allowed)
+{
+    if (allowed != m_checkOnBattery) {
+        m_checkOnBattery = allowed;
+        updateCheckAllowed();
+        emit checkOnBatteryChanged();
     }
-    m_updateList.insert(packageID, summary);
 }
 
-void PkUpdates::onPackageUpdating(PackageKit::Transaction::Info info, const QString &packageID, const QString &summary)
+bool PkUpdates::downloadAhead() const
 {
-    Q_UNUSED(summary)
-    qCDebug(PLASMA_PK_UPDATES) << "Package updating:" << packageID <<
-                ", info:" << PackageKit::Daemon::enumToString<PackageKit::Transaction>((int)info, "Info");
-
-    const uint percent = m_installTrans->percentage();
+    return m_downloadAhead;
+}
 
-    if (percent <= 100) {
-        setStatusMessage(i18nc("1 installation status, 2 pkg name, 3 percentage", "%1 %2 (%3%)",
-                               PkStrings::infoPresent(info), PackageKit::Daemon::packageName(packageID), percent));
-    } else {
-        setStatusMessage(i18nc("1 installation status, 2 pkg name", "%1 %2",
-                               PkStrings::infoPresent(info), PackageKit::Daemon::packageName(packageID), percent));
+void PkUpdates::setDownloadAhead(bool enabled)
+{
+    if (enabled != m_downloadAhead) {
+        m_downloadAhead = enabled;
+        emit downloadAheadChanged();
+        if (m_downloadAhead && !isActive())
+            downloadUpdates();
     }
-
-    setPercentage(percent);
 }
 
-void PkUpdates::onFinished(PackageKit::Transaction::Exit status, uint runtime)
+bool PkUpdates::offlineUpdates() const
 {
-    PackageKit::Transaction * trans = qobject_cast<PackageKit::Transaction *>(sender());
-    if (!trans)
-        return;
+    return m_offlineUpdates;
+}
 
-    trans->deleteLater();
+void PkUpdates::setOfflineUpdates(bool enabled)
+{
+    if (enabled != m_offlineUpdates) {
+        m_offlineUpdates = enabled;
+        emit offlineUpdatesChanged();
+    }
+}
 
-    qCDebug(PLASMA_PK_UPDATES) << "Transaction" << trans->tid().path() <<
-                "finished with status" << PackageKit::Daemon::enumToString<PackageKit::Transaction>((int)status, "Exit") <<
-                "in" << runtime/1000 << "seconds";
+bool PkUpdates::updatePrepared() const
+{
+    return m_updatePrepared;
+}
 
-    if (trans->role() == PackageKit::Transaction::RoleRefreshCache) {
-        m_lastCheckSuccessful = status == PackageKit::Transaction::ExitSuccess; 
+void PkUpdates::onOfflineChanged()
+{
+    setUpdatePrepared(PackageKit::Daemon::offline()->updatePrepared());
+}
 
-        if (m_lastCheckSuccessful) {
-            qCDebug(PLASMA_PK_UPDATES) << "Cache transaction finished successfully";
+void PkUpdates::setUpdatePrepared(bool prepared)
+{
+    if (prepared != m_updatePrepared) {
+        qCDebug(PLASMA_PK_UPDATES) << "Offline update prepared:" << prepared;
+        m_updatePrepared = prepared;
+        publishStatus();
+        emit updatePreparedChanged();
+    }
+}
 
-            // save the timestamp
-            KConfigGroup grp(KSharedConfig::openConfig("plasma-pk-updates"), "General");
-            grp.writeEntry("Timestamp", QDateTime::currentDateTime().toMSecsSinceEpoch());
-            grp.writeEntry("FailedAutoRefeshCount", 0);
-            grp.sync();
+PkUpdates::Urgency PkUpdates::urgency() const
+{
+    return m_urgency;
+}
 
-            return;
-        } else {
-            qCDebug(PLASMA_PK_UPDATES) << "Cache transaction didn't finish successfully";
-            emit done();
-        }
-    } else if (trans->role() == PackageKit::Transaction::RoleGetUpdates) {
-        m_lastCheckSuccessful = status == PackageKit::Transaction::ExitSuccess;
+void PkUpdates::updateUrgency()
+{
+    if (securityCount() > 0)
+        setUrgency(SecurityUrgency);
+    else if (importantCount() > 0)
+        setUrgency(ImportantUrgency);
+    else if (count() > 0)
+        setUrgency(NormalUrgency);
+    else
+        setUrgency(NoUrgency);
+}
 
-        if (m_lastCheckSuccessful) {
-            qCDebug(PLASMA_PK_UPDATES) << "Check updates transaction finished successfully";
-            const int upCount = count();
-            if (upCount != m_lastUpdateCount && m_lastNotification) {
-                qCDebug(PLASMA_PK_UPDATES) << "Disposing old update count notification";
-                m_lastNotification->close();
-            }
-            if (upCount > 0 && upCount != m_lastUpdateCount) {
-                m_lastUpdateCount = upCount;
-                m_lastNotification = KNotification::event(s_eventIdUpdatesAvailable,
-                                     QString(),
-                                     i18np("You have 1 new update", "You have %1 new updates", upCount),
-                                     s_pkUpdatesIconName, nullptr, KNotification::Persistent,
-                                     s_componentName);
-                connect(m_lastNotification, &KNotification::closed, this, [this] {
-                    qCDebug(PLASMA_PK_UPDATES) << "Old notification closed";
-                    m_lastNotification = nullptr;
-                    m_lastUpdateCount = 0;
-                });
-            }
-        } else {
-            qCDebug(PLASMA_PK_UPDATES) << "Check updates transaction didn't finish successfully";
-        }
-        qCDebug(PLASMA_PK_UPDATES) << "Total number of updates: " << count();
-        emit done();
-    } else if (trans->role() == PackageKit::Transaction::RoleUpdatePackages) {
-        qCDebug(PLASMA_PK_UPDATES) << "Finished updating packages:" << m_packages;
-        if (status == PackageKit::Transaction::ExitNeedUntrusted) {
-            qCDebug(PLASMA_PK_UPDATES) << "Transaction needs untrusted packages";
-            // restart transaction with "untrusted" flag
-            installUpdates(m_packages, false /*simulate*/, true /*untrusted*/);
-            return;
-        } else if (status == PackageKit::Transaction::ExitEulaRequired) {
-            qCDebug(PLASMA_PK_UPDATES) << "Acceptance of EULAs required";
-            promptNextEulaAgreement();
-            return;
-        } else if (status == PackageKit::Transaction::ExitSuccess && trans->transactionFlags().testFlag(PackageKit::Transaction::TransactionFlagSimulate)) {
-            qCDebug(PLASMA_PK_UPDATES) << "Simulation finished with success, restarting the transaction";
-            installUpdates(m_packages, false /*simulate*/, false /*untrusted*/);
-            return;
-        } else if (status == PackageKit::Transaction::ExitSuccess) {
-            qCDebug(PLASMA_PK_UPDATES) << "Update packages transaction finished successfully";
-            if (m_lastNotification) {
-                m_lastNotification->close();
-            }
-            KNotification::event(s_eventIdUpdatesInstalled,
-                                 i18n("Updates Installed"),
-                                 i18np("Successfully updated %1 package", "Successfully updated %1 packages", m_packages.count()),
-                                 s_pkUpdatesIconName, nullptr,
-                                 KNotification::CloseOnTimeout,
-                                 s_componentName);
-            emit updatesInstalled();
-        } else {
-            qCDebug(PLASMA_PK_UPDATES) << "Update packages transaction didn't finish successfully";
-            // just try to refresh cache in case of error, the user might have installed the updates manually meanwhile
-            checkUpdates(false /* force */, false /* manual */);
-            return;
-        }
-        setActivity(Idle);
-        return;
-    } else {
-        qCDebug(PLASMA_PK_UPDATES) << "Unhandled transaction type:" << PackageKit::Daemon::enumToString<PackageKit::Transaction>(trans->role(), "Role");
-        setActivity(Idle);
-        return;
+void PkUpdates::setUrgency(Urgency urgency)
+{
+    if (urgency != m_urgency) {
+        qCDebug(PLASMA_PK_UPDATES) << "Urgency changed:" << m_urgency << "->" << urgency;
+        m_urgency = urgency;
+        emit urgencyChanged();
     }
+}
 
-    setActivity(Idle);
-    emit updatesChanged();
+bool PkUpdates::autoInstallSecurity() const
+{
+    return m_autoInstallSecurity;
 }
 
-void PkUpdates::onErrorCode(PackageKit::Transaction::Error error, const QString &details)
+void PkUpdates::setAutoInstallSecurity(bool enabled)
 {
-    showError(error, details);
+    if (enabled != m_autoInstallSecurity) {
+        m_autoInstallSecurity = enabled;
+        emit autoInstallSecurityChanged();
+    }
 }
 
-void PkUpdates::onRefreshErrorCode(PackageKit::Transaction::Error error, const QString &details)
+void PkUpdates::queueSecurityInstall(const PkUpdateTable &updates)
 {
-    if(!m_isManualCheck) {
-        auto isTransientError = [] (PackageKit::Transaction::Error error) {
-            return (error == PackageKit::Transaction::ErrorFailedInitialization) ||
-                   (error == PackageKit::Transaction::ErrorNoNetwork) ||
-                   (error == PackageKit::Transaction::ErrorCannotGetLock);
-        };
+    if (!m_autoInstallSecurity || !isLeader() || m_installTrans)
+        return;
 
-        KConfigGroup grp(KSharedConfig::openConfig("plasma-pk-updates"), "General");
-        auto failCount = grp.readEntry<qint64>("FailedAutoRefeshCount", 0);
-        failCount += 1;
-        grp.writeEntry("FailedAutoRefeshCount", failCount);
-        grp.sync();
+    if (m_queue->isWaiting(QStringLiteral("install"))) {
+        qCDebug(PLASMA_PK_UPDATES) << "Updates are being installed already, not installing security updates automatically";
+        return;
+    }
 
-        if(failCount <= 1 && isTransientError(error)) {
-            qDebug(PLASMA_PK_UPDATES) << "Ignoring notification for likely transient error during automatic check";
-            return;
-        }
+    // only those still in the list count as attempted, the others are gone or superseded
+    QStringList packageIds;
+    QSet<QString> attempted;
+    const QVector<int> rows = updates.rowsOfSeverity(PkUpdateTable::SecuritySeverity);
+    for (int row : rows) {
+        const QString pkgID = updates.packageId(row);
+        if (m_autoInstallAttempted.contains(pkgID))
+            attempted.insert(pkgID);
+        else
+            packageIds << pkgID;
     }
+    m_autoInstallAttempted = attempted;
+    if (packageIds.isEmpty())
+        return;
 
-    showError(error, details);
+    qCDebug(PLASMA_PK_UPDATES) << "Installing" << packageIds.count() << "security updates automatically";
+    for (const QString &pkgID : packageIds)
+        m_autoInstallAttempted.insert(pkgID);
+    startStagedInstall(packageIds, true /* automatic */);
 }
 
-void PkUpdates::showError(PackageKit::Transaction::Error error, const QString &details)
+bool PkUpdates::updatesDownloaded() const
 {
-    qWarning() << "PK error:" << details << "type:" << PackageKit::Daemon::enumToString<PackageKit::Transaction>((int)error, "Error");
-    if (error == PackageKit::Transaction::ErrorBadGpgSignature || error == PackageKit::Transaction::ErrorNoLicenseAgreement)
-        return;
-
-    KNotification::event(s_eventIdError, i18n("Update Error"),
-                         details,
-                         s_pkUpdatesIconName, nullptr,
-                         KNotification::Persistent,
-                         s_componentName);
+    return m_updatesDownloaded && m_downloadedGeneration == m_updatesModel->generation();
 }
 
-void PkUpdates::onRequireRestart(PackageKit::Transaction::Restart type, const QString &packageID)
+void PkUpdates::downloadUpdates()
 {
-    if (type == PackageKit::Transaction::RestartSystem || type == PackageKit::Transaction::RestartSession) {
-        KNotification *notification = new KNotification(s_eventIdRestartRequired, KNotification::Persistent);
-        notification->setComponentName(s_componentName);
-        notification->setIconName(s_pkUpdatesIconName);
-        if (type == PackageKit::Transaction::RestartSystem) {
-            notification->setActions(QStringList{i18nc("@action:button", "Restart")});
-            notification->setTitle(i18n("Restart is required"));
-            notification->setText(i18n("The computer will have to be restarted after the update for the changes to take effect."));
-        } else {
-            notification->setActions(QStringList{i18nc("@action:button", "Logout")});
-            notification->setTitle(i18n("Session restart is required"));
-            notification->setText(i18n("You will need to log out and back in after the update for the changes to take effect."));
-        }
-
-        connect(notification, &KNotification::action1Activated, this, [type] () {
-            QDBusInterface interface("org.kde.ksmserver", "/KSMServer", "org.kde.KSMServerInterface", QDBusConnection::sessionBus());
-            if (type == PackageKit::Transaction::RestartSystem) {
-                interface.asyncCall("logout", 0, 1, 2); // Options: do not ask again | reboot | force
-            } else {
-                interface.asyncCall("logout", 0, 0, 2); // Options: do not ask again | logout | force
-            }
-        });
+    if (!isLeader() || !m_downloadAhead || m_downloadTrans || m_queue->isWaiting(QStringLiteral("download")) ||
+            isSystemUpToDate() || updatesDownloaded())
+        return;
 
-        notification->sendEvent();
+    if (!m_checkAllowed) {
+        qCDebug(PLASMA_PK_UPDATES) << "Not downloading updates ahead, network or battery policy forbids it";
+        return;
     }
 
-    qCDebug(PLASMA_PK_UPDATES) << "RESTART" << PackageKit::Daemon::enumToString<PackageKit::Transaction>((int)type, "Restart")
-             << "is required for package" << packageID;
+    // cancelled by anything more important, whatever is missing gets downloaded by the installation itself
+    m_queue->enqueue(TransactionQueue::Background, QStringLiteral("download"), [this] {
+        return startDownloadUpdates();
+    }, true /* preemptible */);
 }
 
-void PkUpdates::onUpdateDetail(const QString &packageID, const QStringList &updates, const QStringList &obsoletes,
-                               const QStringList &vendorUrls, const QStringList &bugzillaUrls, const QStringList &cveUrls,
-                               PackageKit::Transaction::Restart restart, const QString &updateText, const QString &changelog,
-                               PackageKit::Transaction::UpdateState state, const QDateTime &issued, const QDateTime &updated)
+PackageKit::Transaction * PkUpdates::startDownloadUpdates()
 {
-    Q_UNUSED(updates);
-    Q_UNUSED(obsoletes);
-    Q_UNUSED(vendorUrls);
-    Q_UNUSED(cveUrls);
-    Q_UNUSED(restart);
-    Q_UNUSED(changelog);
-    Q_UNUSED(state);
-    Q_UNUSED(issued);
-    Q_UNUSED(updated);
+    if (!m_downloadAhead || isSystemUpToDate() || updatesDownloaded() || !m_checkAllowed)
+        return nullptr;
+
+    const QStringList pkgIDs = m_updatesModel->updates().packageIds();
+    const quint64 generation = m_updatesModel->generation();
+    qCDebug(PLASMA_PK_UPDATES) << "Downloading" << pkgIDs.count() << "updates ahead";
+
+    PackageKit::Transaction * trans = track(transactions()->updatePackages(pkgIDs, PackageKit::Transaction::TransactionFlagOnlyTrusted |
+                                                                                       PackageKit::Transaction::TransactionFlagOnlyDownload));
+    // let the daemon run it with a lower priority
+    trans->setHints(QStringLiteral("background=true"));
+    m_downloadTrans = trans;
+    m_timings->begin(PhaseTimings::Download);
+
+    connect(trans, &PackageKit::Transaction::errorCode, this, [] (PackageKit::Transaction::Error error, const QString &details) {
+        // not worth a notification, the packages will be downloaded during the installation anyway
+        qCDebug(PLASMA_PK_UPDATES) << "Downloading updates ahead failed:" << details << "type:"
+                                   << PackageKit::Daemon::enumToString<PackageKit::Transaction>((int)error, "Error");
+    });
+    connect(trans, &PackageKit::Transaction::finished, this, [this, trans, generation, pkgIDs] (PackageKit::Transaction::Exit status, uint runtime) {
+        m_timings->end(PhaseTimings::Download, status == PackageKit::Transaction::ExitSuccess, pkgIDs.count());
+        qCDebug(PLASMA_PK_UPDATES) << "Downloading updates ahead finished with status"
+                                   << PackageKit::Daemon::enumToString<PackageKit::Transaction>((int)status, "Exit")
+                                   << "in" << runtime/1000 << "seconds";
+        trans->deleteLater();
+        if (trans == m_downloadTrans)
+            m_downloadTrans = nullptr;
+        if (status == PackageKit::Transaction::ExitSuccess) {
+            m_downloadedGeneration = generation;
+            m_updatesDownloaded = true;
+            emit updatesDownloadedChanged();
+        }
+    });
+    return trans;
+}
 
-    qCDebug(PLASMA_PK_UPDATES) << "Got update details for" << packageID;
+int PkUpdates::installStage() const
+{
+    return m_stagedBatches.isEmpty() ? 0 : m_stagedBatch + 1;
+}
 
-    emit updateDetail(packageID, updateText, bugzillaUrls);
+int PkUpdates::installStageCount() const
+{
+    return m_stagedBatches.count();
 }
 
-void PkUpdates::onRepoSignatureRequired(const QString &packageID, const QString &repoName, const QString &keyUrl, const QString &keyUserid,
-                                        const QString &keyId, const QString &keyFingerprint, const QString &keyTimestamp,
-                                        PackageKit::Transaction::SigType type)
+bool PkUpdates::canResumeInstall() const
 {
-    Q_UNUSED(repoName);
-    Q_UNUSED(keyUrl);
-    Q_UNUSED(keyUserid);
-    Q_UNUSED(keyId);
-    Q_UNUSED(keyFingerprint);
-    Q_UNUSED(keyTimestamp);
-    Q_UNUSED(type);
+    return m_stagedFailed && !m_stagedBatches.isEmpty();
+}
 
-    // TODO provide a way to confirm and import GPG keys
-    qCDebug(PLASMA_PK_UPDATES) << "Repo sig required" << packageID;
+int PkUpdates::queueDepth() const
+{
+    return m_queue->depth();
 }
 
-void PkUpdates::onEulaRequired(const QString &eulaID, const QString &packageID, const QString &vendor, const QString &licenseAgreement)
+int PkUpdates::outstandingTransactions() const
 {
-    m_requiredEulas[eulaID] = {packageID, vendor, licenseAgreement};
+    return m_outstandingTransactions;
 }
 
-void PkUpdates::promptNextEulaAgreement()
+void PkUpdates::setTransactionFactory(TransactionFactory *factory)
 {
-    if(m_requiredEulas.empty()) {
+    m_transactionFactory = factory;
+    if (m_activated)
+        onNetworkStateChanged();
+}
+
+TransactionFactory * PkUpdates::transactions() const
+{
+    return m_transactionFactory ? m_transactionFactory.data() : m_daemonTransactions;
+}
+
+PackageKit::Transaction * PkUpdates::track(PackageKit::Transaction *trans)
+{
+    ++m_outstandingTransactions;
+    emit outstandingTransactionsChanged();
+    connect(trans, &QObject::destroyed, this, [this] {
+        --m_outstandingTransactions;
+        emit outstandingTransactionsChanged();
+    });
+    return trans;
+}
+
+bool PkUpdates::lastCheckSuccessful() const
+{
+    return m_lastCheckSuccessful;
+}
+
+QVariantMap PkUpdates::phaseTimings() const
+{
+    return m_timings->toMap();
+}
+
+bool PkUpdates::recordTimings() const
+{
+    return m_timings->isRecording();
+}
+
+void PkUpdates::setRecordTimings(bool record)
+{
+    if (record != m_timings->isRecording()) {
+        m_timings->setRecording(record);
+        emit recordTimingsChanged();
+    }
+}
+
+int PkUpdates::detailsCacheSize() const
+{
+    return m_updateDetails.maxCost();
+}
+
+void PkUpdates::setDetailsCacheSize(int bytes)
+{
+    bytes = qMax(0, bytes);
+    if (bytes != m_updateDetails.maxCost()) {
+        m_updateDetails.setMaxCost(bytes);
+        emit detailsCacheSizeChanged();
+    }
+}
+
+bool PkUpdates::detailsVisible() const
+{
+    return m_detailsVisible;
+}
+
+void PkUpdates::setDetailsVisible(bool visible)
+{
+    if (visible != m_detailsVisible) {
+        m_detailsVisible = visible;
+        if (m_detailsVisible)
+            m_detailsReleaseTimer->stop();
+        else
+            m_detailsReleaseTimer->start();
+        emit detailsVisibleChanged();
+    }
+}
+
+bool PkUpdates::backgroundNetworkAllowed() const
+{
+    const bool networkAllowed = isNetworkMobile() ? m_checkOnMobile : isNetworkOnline();
+    const bool batteryAllowed = isOnBattery() ? m_checkOnBattery : true;
+    return networkAllowed && batteryAllowed;
+}
+
+void PkUpdates::getUpdateDetails(const QString &pkgID)
+{
+    activate();
+    pruneUpdateDetails();
+
+    if (const UpdateDetail * detail = m_updateDetails.object(pkgID)) {
+        emit updateDetail(pkgID, detail->updateText, detail->urls, detail->changelogText(), detail->issued);
+        return;
+    }
+
+    qCDebug(PLASMA_PK_UPDATES) << "Requesting update details for" << pkgID;
+    m_requestedDetails.insert(pkgID);
+    if (!m_detailsInFlight.contains(pkgID)) {
+        if (!m_pendingDetails.contains(pkgID))
+            m_pendingDetails << pkgID;
+        fetchUpdateDetails();
+    }
+}
+
+void PkUpdates::prefetchUpdateDetails(const QString &pkgID)
+{
+    pruneUpdateDetails();
+
+    if (m_updateDetails.contains(pkgID) || m_detailsInFlight.contains(pkgID) || m_pendingDetails.contains(pkgID))
+        return;
+
+    m_pendingDetails << pkgID;
+    if (m_pendingDetails.count() >= s_detailsBatchSize)
+        fetchUpdateDetails();
+    else if (!m_detailsTimer->isActive())
+        m_detailsTimer->start();
+}
+
+void PkUpdates::fetchUpdateDetails()
+{
+    activate();
+    m_detailsTimer->stop();
+    if (m_pendingDetails.isEmpty())
+        return;
+
+    const QStringList pkgIDs = m_pendingDetails;
+    m_pendingDetails.clear();
+    for (const QString &pkgID : pkgIDs)
+        m_detailsInFlight.insert(pkgID);
+
+    m_queue->enqueue(TransactionQueue::Detail, QString(), [this, pkgIDs] () -> PackageKit::Transaction * {
+        qCDebug(PLASMA_PK_UPDATES) << "Fetching update details for" << pkgIDs.count() << "packages";
+        PackageKit::Transaction * trans = track(transactions()->getUpdatesDetails(pkgIDs));
+        connect(trans, &PackageKit::Transaction::updateDetail, this, &PkUpdates::onUpdateDetail);
+        connect(trans, &PackageKit::Transaction::finished, this, [this, trans, pkgIDs] (PackageKit::Transaction::Exit status, uint) {
+            qCDebug(PLASMA_PK_UPDATES) << "Update details transaction finished with status"
+                                       << PackageKit::Daemon::enumToString<PackageKit::Transaction>((int)status, "Exit");
+            for (const QString &pkgID : pkgIDs) {
+                m_detailsInFlight.remove(pkgID);
+                m_requestedDetails.remove(pkgID);
+            }
+            trans->deleteLater();
+        });
+        return trans;
+    });
+}
+
+void PkUpdates::pruneUpdateDetails()
+{
+    // details stay valid for as long as their package ID is in the list
+    if (m_updateDetailsGeneration == m_updatesModel->generation())
+        return;
+
+    m_updateDetailsGeneration = m_updatesModel->generation();
+    if (m_updateDetails.isEmpty())
+        return;
+
+    const PkUpdateTable &updates = m_updatesModel->updates();
+    QSet<QString> current;
+    current.reserve(updates.count());
+    for (int row = 0; row < updates.count(); ++row)
+        current.insert(updates.packageId(row));
+
+    const QList<QString> cached = m_updateDetails.keys();
+    for (const QString &pkgID : cached) {
+        if (!current.contains(pkgID))
+            m_updateDetails.remove(pkgID);
+    }
+}
+
+QString PkUpdates::timestamp() const
+{
+    const qint64 lastCheck = QDateTime::currentMSecsSinceEpoch() - lastRefreshTimestamp();
+
+    if (lastCheck != -1)
+        return i18n("Last check: %1 ago", KFormat().formatSpelloutDuration(lastCheck));
+
+    return i18n("Last check: never");
+}
+
+void PkUpdates::checkUpdates(bool force, bool manual)
+{
+    activate();
+    m_isManualCheck = manual;
+    // a failed automatic install is retried with the next check the user or the schedule asks for
+    if (manual)
+        m_autoInstallAttempted.clear();
+
+    if (!m_timings->isRunning(PhaseTimings::Trigger))
+        m_timings->begin(PhaseTimings::Trigger);
+
+    if (!m_broker->isLeader()) {
+        // shown until the leader publishes the result
+        if (m_activity != CheckingUpdates)
+            m_activityBeforeBrokerCheck = m_activity;
+        setActivity(CheckingUpdates);
+        m_broker->requestCheck(force, manual);
+        return;
+    }
+
+    if (!isNetworkOnline())
+    {
+        qCDebug(PLASMA_PK_UPDATES) << "Checking updates delayed. Network is offline";
+        m_checkUpdatesWhenNetworkOnline = true;
+        // the delayed check starts its own trigger phase
+        m_timings->end(PhaseTimings::Trigger, false);
+        return;
+    }
+    qCDebug(PLASMA_PK_UPDATES) << "Checking updates, forced";
+
+    // automatic refreshes wait for whatever the user asked for, and make way for it once running
+    m_queue->enqueue(manual ? TransactionQueue::Check : TransactionQueue::Background, QStringLiteral("refresh"), [this, force] () -> PackageKit::Transaction * {
+        m_timings->end(PhaseTimings::Trigger, true);
+        m_timings->begin(PhaseTimings::Refresh);
+        // ask the Packagekit daemon to refresh the cache
+        m_cacheTrans = track(transactions()->refreshCache(force));
+        setActivity(CheckingUpdates);
+
+        // evaluate the result
+        connect(m_cacheTrans.data(), &PackageKit::Transaction::statusChanged, this, &PkUpdates::onStatusChanged);
+        connect(m_cacheTrans.data(), &PackageKit::Transaction::finished, this, &PkUpdates::onFinished);
+        connect(m_cacheTrans.data(), &PackageKit::Transaction::errorCode, this, &PkUpdates::onRefreshErrorCode);
+        connect(m_cacheTrans.data(), &PackageKit::Transaction::requireRestart, this, &PkUpdates::onRequireRestart);
+        connect(m_cacheTrans.data(), &PackageKit::Transaction::repoSignatureRequired, this, &PkUpdates::onRepoSignatureRequired);
+        return m_cacheTrans.data();
+    }, !manual /* preemptible */);
+}
+
+void PkUpdates::checkUpdatesIfNeeded(qint64 maxCacheAge, bool manual)
+{
+    activate();
+    if (!m_broker->isLeader()) {
+        // getUpdates() would wait for a publication which might never come, have the leader check instead;
+        // without forcing the refresh, the daemon skips it while its metadata is fresh
+        checkUpdates(false /* force */, manual);
+        return;
+    }
+
+    if (!m_timings->isRunning(PhaseTimings::Trigger))
+        m_timings->begin(PhaseTimings::Trigger);
+
+    const qint64 lastRefresh = lastRefreshTimestamp();
+    if (lastRefresh != -1 && QDateTime::currentMSecsSinceEpoch() - lastRefresh < maxCacheAge * 1000) {
+        qCDebug(PLASMA_PK_UPDATES) << "Repository metadata still fresh, only getting updates";
+        m_isManualCheck = manual;
+        m_getUpdatesManual = m_getUpdatesManual || manual;
+        getUpdates();
+        return;
+    }
+
+    // someone else (another session, a system timer) might have refreshed the cache meanwhile
+    auto watcher = new QDBusPendingCallWatcher(PackageKit::Daemon::getTimeSinceAction(PackageKit::Transaction::RoleRefreshCache), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, maxCacheAge, manual] (QDBusPendingCallWatcher *call) {
+        call->deleteLater();
+        const QDBusPendingReply<uint> reply = *call;
+        // the daemon returns UINT_MAX if the cache was never refreshed
+        if (reply.isError() || reply.value() == UINT_MAX || qint64(reply.value()) >= maxCacheAge) {
+            checkUpdates(true /* force */, manual);
+            return;
+        }
+
+        qCDebug(PLASMA_PK_UPDATES) << "Cache was refreshed" << reply.value() << "seconds ago, only getting updates";
+        storeRefreshState(QDateTime::currentMSecsSinceEpoch() - qint64(reply.value()) * 1000, 0);
+
+        m_isManualCheck = manual;
+        m_getUpdatesManual = m_getUpdatesManual || manual;
+        getUpdates();
+    });
+}
+
+qint64 PkUpdates::lastRefreshTimestamp() const
+{
+    return m_lastRefresh;
+}
+
+QString PkUpdates::packageName(const QString &pkgId)
+{
+    return PackageKit::Daemon::packageName(pkgId);
+}
+
+QString PkUpdates::packageVersion(const QString &pkgId)
+{
+    return PackageKit::Daemon::packageVersion(pkgId);
+}
+
+void PkUpdates::getUpdates()
+{
+    activate();
+    if (!m_broker->isLeader()) {
+        qCDebug(PLASMA_PK_UPDATES) << "Not getting updates, the leader publishes them";
+        m_getUpdatesTimer->stop();
+        return;
+    }
+
+    if (m_updatesTrans) {
+        qCDebug(PLASMA_PK_UPDATES) << "Getting updates already in progress, queuing another run";
+        m_getUpdatesQueued = true;
+        return;
+    }
+
+    m_getUpdatesTimer->stop();
+    // only a check the user asked for holds up the others, following the daemon's changes gives way to the user
+    const bool manual = m_getUpdatesManual;
+    m_queue->enqueue(manual ? TransactionQueue::Check : TransactionQueue::Background, QStringLiteral("get-updates"),
+                     [this] () -> PackageKit::Transaction * {
+        m_getUpdatesQueued = false;
+        m_getUpdatesManual = false;
+        // when the metadata was still fresh, getting the updates is the first thing a check does
+        m_timings->end(PhaseTimings::Trigger, true);
+        m_timings->begin(PhaseTimings::GetUpdates);
+        m_updatesTrans = track(transactions()->getUpdates());
+        setActivity(GettingUpdates);
+
+        m_pendingUpdates.clear();
+        m_publishedRows = 0;
+        m_streamSeverity = PkUpdateTable::NormalSeverity;
+
+        connect(m_updatesTrans.data(), &PackageKit::Transaction::statusChanged, this, &PkUpdates::onStatusChanged);
+        connect(m_updatesTrans.data(), &PackageKit::Transaction::finished, this, &PkUpdates::onFinished);
+        connect(m_updatesTrans.data(), &PackageKit::Transaction::errorCode, this, &PkUpdates::onErrorCode);
+        connect(m_updatesTrans.data(), &PackageKit::Transaction::package, this, &PkUpdates::onPackage);
+        connect(m_updatesTrans.data(), &PackageKit::Transaction::requireRestart, this, &PkUpdates::onRequireRestart);
+        connect(m_updatesTrans.data(), &PackageKit::Transaction::repoSignatureRequired, this, &PkUpdates::onRepoSignatureRequired);
+        return m_updatesTrans.data();
+    }, !manual /* preemptible */);
+}
+
+void PkUpdates::installUpdates(const QStringList &packageIds, bool simulate, bool untrusted)
+{
+    activate();
+    qCDebug(PLASMA_PK_UPDATES) << "Installing updates" << packageIds << ", simulate:" << simulate << ", untrusted:" << untrusted;
+
+    if (!m_stagedBatches.isEmpty() && (m_stagedFailed ||
+            packageIds != (m_stagedSimulating ? m_stagedPackages : m_stagedBatches.at(m_stagedBatch)))) {
+        qCDebug(PLASMA_PK_UPDATES) << "Abandoning the staged installation";
+        clearStagedInstall();
+    }
+
+    if (simulate && isSimulated(packageIds)) {
+        qCDebug(PLASMA_PK_UPDATES) << "Packages already simulated, skipping the simulation";
+        simulate = false;
+        untrusted = m_simulatedUntrusted;
+    }
+
+    PackageKit::Transaction::TransactionFlags flags = PackageKit::Transaction::TransactionFlagOnlyTrusted;
+    if (simulate) {
+        flags |= PackageKit::Transaction::TransactionFlagSimulate;
+    } else if (untrusted) {
+        flags = PackageKit::Transaction::TransactionFlagNone;
+    }
+
+    m_requiredEulas.clear();
+    m_packages = packageIds;
+    // cancels the download of updates ahead, if any
+    m_queue->enqueue(TransactionQueue::Install, QStringLiteral("install"), [this, flags] () -> PackageKit::Transaction * {
+        m_timings->begin(flags.testFlag(PackageKit::Transaction::TransactionFlagSimulate) ? PhaseTimings::Simulate : PhaseTimings::Install);
+        m_installTrans = track(transactions()->updatePackages(m_packages, flags));
+        m_installFlags = flags;
+        setActivity(InstallingUpdates);
+
+        connect(m_installTrans.data(), &PackageKit::Transaction::statusChanged, this, &PkUpdates::onStatusChanged);
+        connect(m_installTrans.data(), &PackageKit::Transaction::finished, this, &PkUpdates::onFinished);
+        connect(m_installTrans.data(), &PackageKit::Transaction::errorCode, this, &PkUpdates::onErrorCode);
+        connect(m_installTrans.data(), &PackageKit::Transaction::package, this, &PkUpdates::onPackageUpdating);
+        connect(m_installTrans.data(), &PackageKit::Transaction::requireRestart, this, &PkUpdates::onRequireRestart);
+        connect(m_installTrans.data(), &PackageKit::Transaction::repoSignatureRequired, this, &PkUpdates::onRepoSignatureRequired);
+        connect(m_installTrans.data(), &PackageKit::Transaction::eulaRequired, this, &PkUpdates::onEulaRequired);
+        return m_installTrans.data();
+    });
+}
+
+void PkUpdates::installUpdatesStaged(const QStringList &packageIds)
+{
+    startStagedInstall(packageIds, false /* automatic */);
+}
+
+void PkUpdates::startStagedInstall(const QStringList &packageIds, bool automatic)
+{
+    m_autoInstalling = automatic;
+    m_autoInstallIds = automatic ? packageIds : QStringList();
+    if (packageIds.isEmpty())
+        return;
+
+    QList<QStringList> batches;
+    if (packageIds.count() <= s_stagedBatchSize) {
+        batches << packageIds;
+    } else {
+        QSet<QString> selected;
+        selected.reserve(packageIds.count());
+        for (const QString &pkgID : packageIds)
+            selected.insert(pkgID);
+
+        QStringList bySeverity[PkUpdateTable::SeverityCount];
+        const PkUpdateTable &updates = m_updatesModel->updates();
+        for (int row = 0; row < updates.count(); ++row) {
+            const QString pkgID = updates.packageId(row);
+            if (selected.remove(pkgID))
+                bySeverity[updates.severity(row)] << pkgID;
+        }
+        // not in the list (any more), let the daemon decide
+        for (const QString &pkgID : packageIds) {
+            if (selected.contains(pkgID))
+                bySeverity[PkUpdateTable::NormalSeverity] << pkgID;
+        }
+
+        // the daemon pulls in the dependencies of each batch
+        for (int severity = PkUpdateTable::SecuritySeverity; severity >= PkUpdateTable::NormalSeverity; --severity) {
+            for (int i = 0; i < bySeverity[severity].count(); i += s_stagedBatchSize)
+                batches << bySeverity[severity].mid(i, s_stagedBatchSize);
+        }
+    }
+
+    qCDebug(PLASMA_PK_UPDATES) << "Installing" << packageIds.count() << "updates in" << batches.count() << "batches";
+    m_stagedBatches = batches;
+    m_stagedBatch = 0;
+    m_stagedPackages = packageIds;
+    m_stagedFailed = false;
+    emit installStageChanged();
+
+    // one simulation does for all the batches
+    m_stagedSimulated = batches.count() > 1 && isSimulated(packageIds);
+    if (batches.count() > 1 && !m_stagedSimulated) {
+        m_stagedSimulating = true;
+        installUpdates(packageIds);
+        return;
+    }
+    installUpdates(m_stagedBatches.first());
+}
+
+void PkUpdates::installSelected()
+{
+    const QStringList packageIds = m_updatesModel->selectedPackages();
+    qCDebug(PLASMA_PK_UPDATES) << "Installing the" << packageIds.count() << "selected updates";
+    if (m_offlineUpdates)
+        prepareUpdates(packageIds);
+    else
+        installUpdatesStaged(packageIds);
+}
+
+void PkUpdates::prepareUpdates(const QStringList &packageIds)
+{
+    activate();
+    if (packageIds.isEmpty())
+        return;
+
+    qCDebug(PLASMA_PK_UPDATES) << "Preparing" << packageIds.count() << "updates for the next restart";
+    m_queue->enqueue(TransactionQueue::Install, QStringLiteral("prepare"), [this, packageIds] () -> PackageKit::Transaction * {
+        m_timings->begin(PhaseTimings::Download);
+        // downloading an update only makes the daemon prepare it for the offline installation
+        PackageKit::Transaction * trans = track(transactions()->updatePackages(packageIds, PackageKit::Transaction::TransactionFlagOnlyTrusted |
+                                                                                               PackageKit::Transaction::TransactionFlagOnlyDownload));
+        // let the daemon run it with a lower priority
+        trans->setHints(QStringLiteral("background=true"));
+        m_prepareTrans = trans;
+        setActivity(PreparingUpdates);
+
+        connect(trans, &PackageKit::Transaction::statusChanged, this, &PkUpdates::onStatusChanged);
+        connect(trans, &PackageKit::Transaction::errorCode, this, &PkUpdates::onErrorCode);
+        connect(trans, &PackageKit::Transaction::repoSignatureRequired, this, &PkUpdates::onRepoSignatureRequired);
+        connect(trans, &PackageKit::Transaction::finished, this, [this, trans, packageIds] (PackageKit::Transaction::Exit status, uint runtime) {
+            qCDebug(PLASMA_PK_UPDATES) << "Preparing updates finished with status"
+                                       << PackageKit::Daemon::enumToString<PackageKit::Transaction>((int)status, "Exit")
+                                       << "in" << runtime/1000 << "seconds";
+            m_timings->end(PhaseTimings::Download, status == PackageKit::Transaction::ExitSuccess, packageIds.count());
+            trans->deleteLater();
+            if (trans == m_progressTrans) {
+                m_progressTrans = nullptr;
+                m_progressPending = false;
+                m_progressTimer->stop();
+            }
+            setActivity(Idle);
+
+            if (status == PackageKit::Transaction::ExitSuccess) {
+                // the daemon announces it too, but not necessarily before we tell the user
+                setUpdatePrepared(true);
+                m_notifier->updatesPrepared(packageIds.count());
+            }
+        });
+        return trans;
+    });
+}
+
+void PkUpdates::restartToUpdate()
+{
+    restart(PackageKit::Transaction::RestartSystem);
+}
+
+void PkUpdates::cancelPreparedUpdate()
+{
+    activate();
+    qCDebug(PLASMA_PK_UPDATES) << "Cancelling the prepared update";
+    PackageKit::Daemon::offline()->cancel();
+}
+
+void PkUpdates::restart(PackageKit::Transaction::Restart type)
+{
+    auto logout = [type] () {
+        QDBusInterface interface("org.kde.ksmserver", "/KSMServer", "org.kde.KSMServerInterface", QDBusConnection::sessionBus());
+        if (type == PackageKit::Transaction::RestartSystem) {
+            interface.asyncCall("logout", 0, 1, 2); // Options: do not ask again | reboot | force
+        } else {
+            interface.asyncCall("logout", 0, 0, 2); // Options: do not ask again | logout | force
+        }
+    };
+
+    if (type != PackageKit::Transaction::RestartSystem || !m_updatePrepared) {
+        logout();
+        return;
+    }
+
+    // have the prepared update installed while rebooting
+    qCDebug(PLASMA_PK_UPDATES) << "Triggering the offline update";
+    auto watcher = new QDBusPendingCallWatcher(PackageKit::Daemon::offline()->trigger(PackageKit::Offline::ActionReboot), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [logout] (QDBusPendingCallWatcher *call) {
+        call->deleteLater();
+        const QDBusPendingReply<> reply = *call;
+        if (reply.isError())
+            qCWarning(PLASMA_PK_UPDATES) << "Triggering the offline update failed:" << reply.error().message();
+        logout();
+    });
+}
+
+void PkUpdates::resumeStagedInstall()
+{
+    m_autoInstalling = false;
+    if (!canResumeInstall())
+        return;
+
+    // the packages might have been updated meanwhile, only keep those still available
+    const PkUpdateTable &updates = m_updatesModel->updates();
+    QSet<QString> available;
+    available.reserve(updates.count());
+    for (int row = 0; row < updates.count(); ++row)
+        available.insert(updates.packageId(row));
+
+    QList<QStringList> batches;
+    for (int i = m_stagedBatch; i < m_stagedBatches.count(); ++i) {
+        QStringList batch;
+        for (const QString &pkgID : m_stagedBatches.at(i)) {
+            if (available.contains(pkgID))
+                batch << pkgID;
+        }
+        if (!batch.isEmpty())
+            batches << batch;
+    }
+
+    if (batches.isEmpty()) {
+        qCDebug(PLASMA_PK_UPDATES) << "Nothing left to resume";
+        clearStagedInstall();
+        return;
+    }
+
+    qCDebug(PLASMA_PK_UPDATES) << "Resuming the staged installation with" << batches.count() << "batches";
+    // keep counting the batches already installed
+    m_stagedBatches = m_stagedBatches.mid(0, m_stagedBatch) + batches;
+    m_stagedFailed = false;
+    emit installStageChanged();
+
+    installUpdates(m_stagedBatches.at(m_stagedBatch), !m_stagedSimulated, m_stagedSimulated && m_simulatedUntrusted);
+}
+
+void PkUpdates::clearStagedInstall()
+{
+    if (m_stagedBatches.isEmpty())
+        return;
+
+    m_stagedBatches.clear();
+    m_stagedBatch = 0;
+    m_stagedPackages.clear();
+    m_stagedSimulating = false;
+    m_stagedSimulated = false;
+    m_stagedFailed = false;
+    emit installStageChanged();
+}
+
+void PkUpdates::onChanged()
+{
+    qCDebug(PLASMA_PK_UPDATES) << "Daemon changed";
+}
+
+void PkUpdates::onUpdatesChanged()
+{
+    qCDebug(PLASMA_PK_UPDATES) << "Updates changed, scheduling getting updates";
+    scheduleGetUpdates();
+}
+
+void PkUpdates::scheduleGetUpdates()
+{
+    if (m_updatesTrans) {
+        // at most one follow-up run, started once the current one finishes
+        m_getUpdatesQueued = true;
+        return;
+    }
+
+    // (re)start the timer, collapsing a burst of notifications into a single run
+    m_getUpdatesTimer->start();
+}
+
+void PkUpdates::onStatusChanged()
+{
+    PackageKit::Transaction * trans;
+    if ((trans = qobject_cast<PackageKit::Transaction *>(sender()))) {
+        qCDebug(PLASMA_PK_UPDATES) << "Transaction status changed:"
+                 << PackageKit::Daemon::enumToString<PackageKit::Transaction>((int)trans->status(), "Status")
+                 << QStringLiteral("(%1%)").arg(trans->percentage());
+        if (trans->status() == PackageKit::Transaction::StatusWait) {
+            if (trans != m_waitingTrans) {
+                m_waitingTrans = trans;
+                m_timings->begin(PhaseTimings::QueueWait);
+            }
+        } else if (trans == m_waitingTrans) {
+            m_waitingTrans = nullptr;
+            m_timings->end(PhaseTimings::QueueWait, true);
+        }
+
+        if (trans->status() == PackageKit::Transaction::StatusFinished)
+            return;
+        m_progressTrans = trans;
+        m_progressForPackage = false;
+        scheduleProgressUpdate();
+    }
+}
+
+void PkUpdates::onPackage(PackageKit::Transaction::Info info, const QString &packageID, const QString &summary)
+{
+    qCDebug(PLASMA_PK_UPDATES) << "Got update package:" << packageID << ", summary:" << summary <<
+                ", type:" << PackageKit::Daemon::enumToString<PackageKit::Transaction>((int)info, "Info");
+
+    // Blocked updates are not installable updates so there is no
+    // reason to show/count them
+    if (info == PackageKit::Transaction::InfoBlocked)
+        return;
+
+    m_pendingUpdates.append(info, packageID, summary);
+    const int severity = PkUpdateTable::severityForInfo(info);
+    emit updateFound(packageID, summary, severity);
+
+    if (severity > m_streamSeverity) {
+        qCDebug(PLASMA_PK_UPDATES) << "First update of severity" << severity << "arrived:" << packageID;
+        m_streamSeverity = severity;
+        emit urgentUpdateFound(packageID, severity);
+        // don't make the user wait for the rest of the list to learn about it
+        publishPendingUpdates();
+        return;
+    }
+
+    // show the updates while they're still arriving, in chunks to keep the views from relayouting all the time
+    if (m_pendingUpdates.count() - m_publishedRows >= s_publishBatchSize)
+        publishPendingUpdates();
+    else if (!m_publishTimer->isActive())
+        m_publishTimer->start();
+}
+
+void PkUpdates::publishPendingUpdates()
+{
+    m_publishTimer->stop();
+    if (m_publishedRows == m_pendingUpdates.count())
+        return;
+
+    const bool wasDownloaded = updatesDownloaded();
+    m_updatesModel->mergeUpdates(m_pendingUpdates, m_publishedRows);
+    m_publishedRows = m_pendingUpdates.count();
+    if (wasDownloaded != updatesDownloaded())
+        emit updatesDownloadedChanged();
+    emit updatesChanged();
+}
+
+void PkUpdates::onPackageUpdating(PackageKit::Transaction::Info info, const QString &packageID, const QString &summary)
+{
+    Q_UNUSED(summary)
+    qCDebug(PLASMA_PK_UPDATES) << "Package updating:" << packageID <<
+                ", info:" << PackageKit::Daemon::enumToString<PackageKit::Transaction>((int)info, "Info");
+
+    m_progressTrans = m_installTrans;
+    m_progressForPackage = true;
+    m_progressInfo = info;
+    m_progressPackageID = packageID;
+    scheduleProgressUpdate();
+}
+
+void PkUpdates::scheduleProgressUpdate()
+{
+    // show the first change right away, then coalesce the following ones
+    if (m_progressTimer->isActive()) {
+        m_progressPending = true;
+        return;
+    }
+
+    updateProgress();
+    m_progressTimer->start();
+}
+
+void PkUpdates::onProgressTimeout()
+{
+    if (m_progressPending) {
+        m_progressPending = false;
+        updateProgress();
+        m_progressTimer->start();
+    }
+}
+
+void PkUpdates::updateProgress()
+{
+    if (!m_progressTrans)
+        return;
+
+    const uint percent = m_progressTrans->percentage();
+
+    if (!m_progressForPackage) {
+        setStatusMessage(PkStrings::status(m_progressTrans->status(), m_progressTrans->speed(), m_progressTrans->downloadSizeRemaining()));
+    } else if (percent <= 100) {
+        setStatusMessage(i18nc("1 installation status, 2 pkg name, 3 percentage", "%1 %2 (%3%)",
+                               PkStrings::infoPresent(m_progressInfo), PackageKit::Daemon::packageName(m_progressPackageID), percent));
+    } else {
+        setStatusMessage(i18nc("1 installation status, 2 pkg name", "%1 %2",
+                               PkStrings::infoPresent(m_progressInfo), PackageKit::Daemon::packageName(m_progressPackageID)));
+    }
+
+    setPercentage(percent);
+}
+
+void PkUpdates::onFinished(PackageKit::Transaction::Exit status, uint runtime)
+{
+    PackageKit::Transaction * trans = qobject_cast<PackageKit::Transaction *>(sender());
+    if (!trans)
+        return;
+
+    trans->deleteLater();
+
+    if (trans == m_progressTrans) {
+        // don't show a stale progress of a finished transaction
+        m_progressTrans = nullptr;
+        m_progressPending = false;
+        m_progressTimer->stop();
+    }
+
+    qCDebug(PLASMA_PK_UPDATES) << "Transaction" << trans->tid().path() <<
+                "finished with status" << PackageKit::Daemon::enumToString<PackageKit::Transaction>((int)status, "Exit") <<
+                "in" << runtime/1000 << "seconds";
+
+    if (trans == m_waitingTrans) {
+        m_waitingTrans = nullptr;
+        m_timings->end(PhaseTimings::QueueWait, false);
+    }
+
+    // told apart by what they were started as, the daemon's properties of a transaction don't have to be known yet
+    if (trans == m_cacheTrans && m_queue->isPreempted(trans)) {
+        m_timings->end(PhaseTimings::Refresh, false);
+        // not a failure, the automatic refresh just has to wait for the user's transaction
+        if (!m_queue->isWaiting(QStringLiteral("refresh"))) {
+            qCDebug(PLASMA_PK_UPDATES) << "Cache transaction cancelled in favor of another one, queueing it again";
+            checkUpdates(true /* force */, false /* manual */);
+        }
+        return;
+    } else if (trans == m_cacheTrans) {
+        m_lastCheckSuccessful = status == PackageKit::Transaction::ExitSuccess; 
+        m_timings->end(PhaseTimings::Refresh, m_lastCheckSuccessful);
+
+        if (m_lastCheckSuccessful) {
+            qCDebug(PLASMA_PK_UPDATES) << "Cache transaction finished successfully";
+
+            // save the timestamp
+            storeRefreshState(QDateTime::currentMSecsSinceEpoch(), 0);
+
+            // the daemon announces the new updates too, both get coalesced into a single run
+            m_getUpdatesManual = m_getUpdatesManual || m_isManualCheck;
+            scheduleGetUpdates();
+            return;
+        } else {
+            qCDebug(PLASMA_PK_UPDATES) << "Cache transaction didn't finish successfully";
+            emit done();
+        }
+    } else if (trans == m_updatesTrans && m_queue->isPreempted(trans)) {
+        m_updatesTrans = nullptr;
+        m_timings->end(PhaseTimings::GetUpdates, false, m_pendingUpdates.count());
+        // keep what was published so far, the next run brings the list up to date
+        m_publishTimer->stop();
+        m_updatesModel->endMerge(false);
+        m_pendingUpdates.clear();
+        m_publishedRows = 0;
+        m_streamSeverity = PkUpdateTable::NormalSeverity;
+        qCDebug(PLASMA_PK_UPDATES) << "Getting updates cancelled in favor of another transaction, queueing it again";
+        getUpdates();
+        return;
+    } else if (trans == m_updatesTrans) {
+        m_updatesTrans = nullptr;
+        onGetUpdatesFinished(status);
+        return;
+    } else if (trans == m_installTrans) {
+        qCDebug(PLASMA_PK_UPDATES) << "Finished updating packages:" << m_packages;
+        m_timings->end(m_installFlags.testFlag(PackageKit::Transaction::TransactionFlagSimulate) ? PhaseTimings::Simulate : PhaseTimings::Install,
+                       status == PackageKit::Transaction::ExitSuccess, m_packages.count());
+        if (status == PackageKit::Transaction::ExitNeedUntrusted) {
+            qCDebug(PLASMA_PK_UPDATES) << "Transaction needs untrusted packages";
+            if (m_autoInstalling) {
+                qCDebug(PLASMA_PK_UPDATES) << "Not installing untrusted packages automatically";
+                m_autoInstalling = false;
+                m_autoInstallIds.clear();
+                clearStagedInstall();
+                setActivity(Idle);
+                emit installFailed();
+                return;
+            }
+            rememberSimulation(m_packages, true /*untrusted*/);
+            // restart transaction with "untrusted" flag
+            installSimulated(true /*untrusted*/);
+            return;
+        } else if (status == PackageKit::Transaction::ExitEulaRequired) {
+            qCDebug(PLASMA_PK_UPDATES) << "Acceptance of EULAs required";
+            if (m_installFlags.testFlag(PackageKit::Transaction::TransactionFlagSimulate)) {
+                // accepting them is all the simulation found, a retry won't have to resolve them again
+                QSet<QString> eulas;
+                for (auto it = m_requiredEulas.constBegin(); it != m_requiredEulas.constEnd(); ++it)
+                    eulas.insert(it.key());
+                rememberSimulation(m_packages, false /*untrusted*/, eulas);
+            }
+            promptNextEulaAgreement();
+            return;
+        } else if (status == PackageKit::Transaction::ExitSuccess && m_installFlags.testFlag(PackageKit::Transaction::TransactionFlagSimulate)) {
+            qCDebug(PLASMA_PK_UPDATES) << "Simulation finished with success, restarting the transaction";
+            rememberSimulation(m_packages, false /*untrusted*/);
+            installSimulated(false /*untrusted*/);
+            return;
+        } else if (status == PackageKit::Transaction::ExitSuccess) {
+            qCDebug(PLASMA_PK_UPDATES) << "Update packages transaction finished successfully";
+            if (m_stagedBatch + 1 < m_stagedBatches.count()) {
+                ++m_stagedBatch;
+                emit installStageChanged();
+                qCDebug(PLASMA_PK_UPDATES) << "Installing batch" << installStage() << "of" << installStageCount();
+                installUpdates(m_stagedBatches.at(m_stagedBatch), !m_stagedSimulated, m_stagedSimulated && m_simulatedUntrusted);
+                return;
+            }
+            m_simulatedPackages.clear();
+            const int installedCount = m_stagedBatches.isEmpty() ? m_packages.count() : m_stagedPackages.count();
+            clearStagedInstall();
+            m_autoInstalling = false;
+            m_autoInstallIds.clear();
+            m_notifier->updatesInstalled(installedCount);
+            emit updatesInstalled();
+        } else {
+            qCDebug(PLASMA_PK_UPDATES) << "Update packages transaction didn't finish successfully";
+            m_autoInstalling = false;
+            m_autoInstallIds.clear();
+            if (!m_stagedBatches.isEmpty()) {
+                qCDebug(PLASMA_PK_UPDATES) << "Staged installation failed at batch" << installStage() << "of" << installStageCount();
+                m_stagedSimulating = false;
+                m_stagedFailed = true;
+                emit installStageChanged();
+            }
+            emit installFailed();
+            // just try to refresh cache in case of error, the user might have installed the updates manually meanwhile
+            checkUpdates(false /* force */, false /* manual */);
+            return;
+        }
+        setActivity(Idle);
+        return;
+    } else {
+        qCDebug(PLASMA_PK_UPDATES) << "Unhandled transaction type:" << PackageKit::Daemon::enumToString<PackageKit::Transaction>(trans->role(), "Role");
+        setActivity(Idle);
+        return;
+    }
+
+    setActivity(Idle);
+    emit updatesChanged();
+}
+
+void PkUpdates::onGetUpdatesFinished(PackageKit::Transaction::Exit status)
+{
+    m_timings->end(PhaseTimings::GetUpdates, status == PackageKit::Transaction::ExitSuccess, m_pendingUpdates.count());
+
+    if (m_getUpdatesQueued) {
+        qCDebug(PLASMA_PK_UPDATES) << "Updates changed while getting them, scheduling another run";
+        m_getUpdatesQueued = false;
+        scheduleGetUpdates();
+    }
+
+    m_lastCheckSuccessful = status == PackageKit::Transaction::ExitSuccess;
+    m_publishTimer->stop();
+
+    if (m_lastCheckSuccessful) {
+        qCDebug(PLASMA_PK_UPDATES) << "Check updates transaction finished successfully";
+        const bool wasDownloaded = updatesDownloaded();
+        // the rows not published yet, then drop the updates which didn't come back
+        m_updatesModel->mergeUpdates(m_pendingUpdates, m_publishedRows);
+        m_updatesModel->endMerge();
+        const qint64 checked = QDateTime::currentMSecsSinceEpoch();
+        saveCache(checked);
+        queueSecurityInstall(m_updatesModel->updates());
+        if (wasDownloaded != updatesDownloaded())
+            emit updatesDownloadedChanged();
+        // the download itself only starts once we're idle again
+        QTimer::singleShot(0, this, &PkUpdates::downloadUpdates);
+        m_notifier->updatesAvailable(count());
+        storeCheckTimestamp(checked);
+    } else {
+        qCDebug(PLASMA_PK_UPDATES) << "Check updates transaction didn't finish successfully";
+        // keep what was published so far along with the previous updates, the cache still has the latter
+        m_updatesModel->endMerge(false);
+    }
+    m_pendingUpdates.clear();
+    m_publishedRows = 0;
+    m_streamSeverity = PkUpdateTable::NormalSeverity;
+    qCDebug(PLASMA_PK_UPDATES) << "Total number of updates: " << count();
+    emit done();
+
+    setActivity(Idle);
+    emit updatesChanged();
+}
+
+void PkUpdates::onErrorCode(PackageKit::Transaction::Error error, const QString &details)
+{
+    PackageKit::Transaction * trans = qobject_cast<PackageKit::Transaction *>(sender());
+    if (error == PackageKit::Transaction::ErrorTransactionCancelled && trans && m_queue->isPreempted(trans)) {
+        qCDebug(PLASMA_PK_UPDATES) << "Transaction cancelled in favor of another one";
+        return;
+    }
+
+    showError(error, details);
+}
+
+void PkUpdates::onRefreshErrorCode(PackageKit::Transaction::Error error, const QString &details)
+{
+    PackageKit::Transaction * trans = qobject_cast<PackageKit::Transaction *>(sender());
+    if (error == PackageKit::Transaction::ErrorTransactionCancelled && trans && m_queue->isPreempted(trans)) {
+        qCDebug(PLASMA_PK_UPDATES) << "Automatic refresh cancelled in favor of another transaction";
+        return;
+    }
+
+    if(!m_isManualCheck) {
+        auto isTransientError = [] (PackageKit::Transaction::Error error) {
+            return (error == PackageKit::Transaction::ErrorFailedInitialization) ||
+                   (error == PackageKit::Transaction::ErrorNoNetwork) ||
+                   (error == PackageKit::Transaction::ErrorCannotGetLock);
+        };
+
+        const int failCount = m_failedAutoRefreshCount + 1;
+        storeRefreshState(m_lastRefresh, failCount);
+
+        if(failCount <= 1 && isTransientError(error)) {
+            qDebug(PLASMA_PK_UPDATES) << "Ignoring notification for likely transient error during automatic check";
+            return;
+        }
+    }
+
+    showError(error, details);
+}
+
+void PkUpdates::showError(PackageKit::Transaction::Error error, const QString &details)
+{
+    qWarning() << "PK error:" << details << "type:" << PackageKit::Daemon::enumToString<PackageKit::Transaction>((int)error, "Error");
+    if (error == PackageKit::Transaction::ErrorBadGpgSignature || error == PackageKit::Transaction::ErrorNoLicenseAgreement)
+        return;
+
+    m_notifier->error(details);
+}
+
+void PkUpdates::onRequireRestart(PackageKit::Transaction::Restart type, const QString &packageID)
+{
+    m_notifier->restartRequired(type, packageID);
+
+    qCDebug(PLASMA_PK_UPDATES) << "RESTART" << PackageKit::Daemon::enumToString<PackageKit::Transaction>((int)type, "Restart")
+             << "is required for package" << packageID;
+}
+
+void PkUpdates::onUpdateDetail(const QString &packageID, const QStringList &updates, const QStringList &obsoletes,
+                               const QStringList &vendorUrls, const QStringList &bugzillaUrls, const QStringList &cveUrls,
+                               PackageKit::Transaction::Restart restart, const QString &updateText, const QString &changelog,
+                               PackageKit::Transaction::UpdateState state, const QDateTime &issued, const QDateTime &updated)
+{
+    Q_UNUSED(updates);
+    Q_UNUSED(obsoletes);
+    Q_UNUSED(vendorUrls);
+    Q_UNUSED(restart);
+    Q_UNUSED(state);
+    Q_UNUSED(updated);
+
+    qCDebug(PLASMA_PK_UPDATES) << "Got update details for" << packageID;
+
+    UpdateDetail * detail = new UpdateDetail;
+    detail->updateText = updateText;
+    if (changelog.size() > s_compressedChangelogSize)
+        detail->compressedChangelog = qCompress(changelog.toUtf8());
+    else
+        detail->changelog = changelog;
+    detail->urls = bugzillaUrls + cveUrls;
+    detail->issued = issued;
+
+    if (m_requestedDetails.remove(packageID))
+        emit updateDetail(packageID, updateText, detail->urls, changelog, issued);
+
+    // not kept if it alone is over budget
+    m_updateDetails.insert(packageID, detail, detail->cost());
+    // fetched without being shown, e.g. by the console or ahead of the binding, gets released all the same
+    if (!m_detailsVisible)
+        m_detailsReleaseTimer->start();
+}
+
+QString PkUpdates::UpdateDetail::changelogText() const
+{
+    if (!compressedChangelog.isEmpty())
+        return QString::fromUtf8(qUncompress(compressedChangelog));
+    return changelog;
+}
+
+int PkUpdates::UpdateDetail::cost() const
+{
+    int bytes = sizeof(UpdateDetail) + (updateText.size() + changelog.size()) * int(sizeof(QChar)) + compressedChangelog.size();
+    for (const QString &url : urls)
+        bytes += url.size() * int(sizeof(QChar));
+    return bytes;
+}
+
+void PkUpdates::onRepoSignatureRequired(const QString &packageID, const QString &repoName, const QString &keyUrl, const QString &keyUserid,
+                                        const QString &keyId, const QString &keyFingerprint, const QString &keyTimestamp,
+                                        PackageKit::Transaction::SigType type)
+{
+    Q_UNUSED(repoName);
+    Q_UNUSED(keyUrl);
+    Q_UNUSED(keyUserid);
+    Q_UNUSED(keyId);
+    Q_UNUSED(keyFingerprint);
+    Q_UNUSED(keyTimestamp);
+    Q_UNUSED(type);
+
+    // TODO provide a way to confirm and import GPG keys
+    qCDebug(PLASMA_PK_UPDATES) << "Repo sig required" << packageID;
+}
+
+void PkUpdates::onEulaRequired(const QString &eulaID, const QString &packageID, const QString &vendor, const QString &licenseAgreement)
+{
+    m_requiredEulas[eulaID] = {packageID, vendor, licenseAgreement};
+}
+
+void PkUpdates::onCheckDue()
+{
+    if (!m_scheduler->isDue() || !isLeader())
+        return;
+
+    if (isActive()) {
+        // not every transaction ends with done() and a new schedule, so don't rely on it
+        qCDebug(PLASMA_PK_UPDATES) << "Update check is due, waiting for the running transaction";
+        m_scheduler->retryLater();
+        return;
+    }
+
+    if (!m_checkAllowed) {
+        qCDebug(PLASMA_PK_UPDATES) << "Update check is due, waiting for the network and battery policy to allow it";
+        return;
+    }
+
+    m_autoInstallAttempted.clear();
+    // refreshes once the metadata is as old as the interval, the scheduler's checks in between only get the updates
+    checkUpdatesIfNeeded(m_scheduler->interval(), false /* manual */);
+}
+
+void PkUpdates::onLeaderChanged()
+{
+    if (!m_broker->isLeader())
+        return;
+
+    // taking over from a previous leader, refresh what it published and resume its schedule
+    qCDebug(PLASMA_PK_UPDATES) << "Became the leader, getting updates";
+    connectDaemon();
+    scheduleGetUpdates();
+    onCheckDue();
+}
+
+void PkUpdates::onBrokerUpdates(const PkUpdateTable &updates)
+{
+    const bool wasDownloaded = updatesDownloaded();
+    m_updatesModel->setUpdates(updates);
+    if (wasDownloaded != updatesDownloaded())
+        emit updatesDownloadedChanged();
+    emit updatesChanged();
+}
+
+void PkUpdates::onBrokerPublication(bool lastCheckSuccessful, bool checkPending)
+{
+    // the leader has written the timestamp of its check
+    m_config->reparseConfiguration();
+    loadRefreshState();
+    m_lastCheckSuccessful = lastCheckSuccessful;
+
+    // published before the leader got to the check we asked for
+    if (checkPending)
+        return;
+
+    if (m_activity == CheckingUpdates)
+        setActivity(Idle);
+    emit done();
+}
+
+void PkUpdates::onBrokerStatus(uint networkState, bool updatePrepared)
+{
+    setNetworkState(PackageKit::Daemon::Network(networkState));
+    setUpdatePrepared(updatePrepared);
+}
+
+void PkUpdates::onBrokerCheckFailed()
+{
+    qCDebug(PLASMA_PK_UPDATES) << "The leader didn't check for updates on our behalf";
+    m_timings->end(PhaseTimings::Trigger, false);
+    m_lastCheckSuccessful = false;
+    if (m_activity == CheckingUpdates)
+        setActivity(m_activityBeforeBrokerCheck);
+    emit done();
+}
+
+bool PkUpdates::isLeader() const
+{
+    return m_broker && m_broker->isLeader();
+}
+
+void PkUpdates::promptNextEulaAgreement()
+{
+    if(m_requiredEulas.empty()) {
         // Restart the transaction
-        installUpdates(m_packages, false, false);
+        installSimulated(false /*untrusted*/);
         return;
     }
 
@@ -608,32 +1826,182 @@ void PkUpdates::promptNextEulaAgreement()
     emit eulaRequired(eulaID, eula.packageID, eula.vendor, eula.licenseAgreement);
 }
 
+void PkUpdates::installSimulated(bool untrusted)
+{
+    if (m_stagedSimulating) {
+        // the simulation covered all the batches, go on with the first one
+        m_stagedSimulating = false;
+        m_stagedSimulated = true;
+        installUpdates(m_stagedBatches.at(m_stagedBatch), false /*simulate*/, untrusted);
+        return;
+    }
+    installUpdates(m_packages, false /*simulate*/, untrusted);
+}
+
+void PkUpdates::rememberSimulation(const QStringList &packageIds, bool untrusted, const QSet<QString> &eulas)
+{
+    m_simulatedPackages = packageIds;
+    m_simulatedPackages.sort();
+    m_simulatedGeneration = m_updatesModel->generation();
+    m_simulatedUntrusted = untrusted;
+    m_simulatedEulas = eulas;
+}
+
+bool PkUpdates::isSimulated(const QStringList &packageIds) const
+{
+    if (m_simulatedPackages.isEmpty() || m_simulatedGeneration != m_updatesModel->generation()
+            || packageIds.count() > m_simulatedPackages.count() || !m_acceptedEulas.contains(m_simulatedEulas)) {
+        return false;
+    }
+
+    auto simulated = [this] (const QStringList &pkgIDs) {
+        for (const QString &pkgID : pkgIDs) {
+            if (!std::binary_search(m_simulatedPackages.constBegin(), m_simulatedPackages.constEnd(), pkgID))
+                return false;
+        }
+        return true;
+    };
+
+    // the daemon resolves a subset on its own, so only exactly the simulated packages are covered...
+    if (packageIds.count() == m_simulatedPackages.count())
+        return simulated(packageIds);
+
+    // ...except for the batches of a staged installation whose packages were simulated all together
+    return m_stagedBatches.contains(packageIds) && m_stagedPackages.count() == m_simulatedPackages.count()
+            && simulated(m_stagedPackages) && simulated(packageIds);
+}
+
 void PkUpdates::eulaAgreementResult(const QString &eulaID, bool agreed)
 {
+    activate();
     if(!agreed) {
         qCDebug(PLASMA_PK_UPDATES) << "EULA declined";
+        emit installFailed();
         // Do the same as the failure case in onFinished
         checkUpdates(false /* force */, m_isManualCheck /* manual */);
         return;
     }
 
-    m_eulaTrans = PackageKit::Daemon::acceptEula(eulaID);
-    connect(m_eulaTrans.data(), &PackageKit::Transaction::finished, this,
-            [this, eulaID] (PackageKit::Transaction::Exit exit, uint) {
-                if (exit == PackageKit::Transaction::ExitSuccess) {
-                    m_requiredEulas.remove(eulaID);
-                    promptNextEulaAgreement();
-                } else {
-                    qCWarning(PLASMA_PK_UPDATES) << "EULA acceptance failed";
+    m_queue->enqueue(TransactionQueue::Install, QStringLiteral("eula"), [this, eulaID] () -> PackageKit::Transaction * {
+        PackageKit::Transaction * trans = track(transactions()->acceptEula(eulaID));
+        m_eulaTrans = trans;
+        connect(trans, &PackageKit::Transaction::finished, this,
+                [this, trans, eulaID] (PackageKit::Transaction::Exit exit, uint) {
+                    trans->deleteLater();
+                    if (exit == PackageKit::Transaction::ExitSuccess) {
+                        m_acceptedEulas.insert(eulaID);
+                        m_requiredEulas.remove(eulaID);
+                        promptNextEulaAgreement();
+                    } else {
+                        qCWarning(PLASMA_PK_UPDATES) << "EULA acceptance failed";
+                    }
                 }
-            }
-    );
+        );
+        return trans;
+    });
+}
+
+void PkUpdates::loadRefreshState()
+{
+    KConfigGroup grp(m_config, "General");
+    m_lastRefresh = grp.readEntry<qint64>("Timestamp", -1);
+    m_failedAutoRefreshCount = grp.readEntry<int>("FailedAutoRefeshCount", 0);
+}
+
+void PkUpdates::storeRefreshState(qint64 timestamp, int failedAutoRefreshCount)
+{
+    m_lastRefresh = timestamp;
+    m_failedAutoRefreshCount = failedAutoRefreshCount;
+
+    KConfigGroup grp(m_config, "General");
+    grp.writeEntry("Timestamp", timestamp);
+    grp.writeEntry("FailedAutoRefeshCount", failedAutoRefreshCount);
+    scheduleConfigSync();
+}
+
+void PkUpdates::storeCheckTimestamp(qint64 timestamp)
+{
+    // the scheduler plans the next check against the existing metadata from it
+    KConfigGroup grp(m_config, "General");
+    grp.writeEntry("LastCheck", timestamp);
+    scheduleConfigSync();
+}
+
+void PkUpdates::scheduleConfigSync()
+{
+    // the scheduler reads the entries from memory, nobody is waiting for the file
+    if (!m_configSyncTimer->isActive())
+        m_configSyncTimer->start();
+}
+
+void PkUpdates::syncConfig()
+{
+    m_configSyncTimer->stop();
+    if (!m_config->sync())
+        qCWarning(PLASMA_PK_UPDATES) << "Failed to write the config";
+}
+
+bool PkUpdates::loadCache()
+{
+    QFile file(cacheFilePath());
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic, version;
+    stream >> magic >> version;
+    if (stream.status() != QDataStream::Ok || magic != s_cacheMagic || version != s_cacheVersion) {
+        qCDebug(PLASMA_PK_UPDATES) << "Ignoring incompatible update cache" << file.fileName();
+        return false;
+    }
+
+    // the file lives apart from the config, which might have been reset or be someone else's meanwhile
+    qint64 checked;
+    stream >> checked;
+    if (stream.status() != QDataStream::Ok || checked != KConfigGroup(m_config, "General").readEntry<qint64>("LastCheck", -1)) {
+        qCDebug(PLASMA_PK_UPDATES) << "Ignoring the update cache of another check" << file.fileName();
+        return false;
+    }
+
+    PkUpdateTable updates;
+    stream >> updates;
+    if (stream.status() != QDataStream::Ok) {
+        qCWarning(PLASMA_PK_UPDATES) << "Failed to read the update cache" << file.fileName();
+        return false;
+    }
+
+    qCDebug(PLASMA_PK_UPDATES) << "Loaded" << updates.count() << "updates from the cache";
+    m_updatesModel->setUpdates(updates);
+    return true;
+}
+
+void PkUpdates::saveCache(qint64 checked) const
+{
+    const QString path = cacheFilePath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(PLASMA_PK_UPDATES) << "Failed to open the update cache" << path << file.errorString();
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << s_cacheMagic << s_cacheVersion << checked << m_updatesModel->updates();
+
+    if (!file.commit())
+        qCWarning(PLASMA_PK_UPDATES) << "Failed to write the update cache" << path << file.errorString();
 }
 
 void PkUpdates::setStatusMessage(const QString &message)
 {
-    m_statusMessage = message;
-    emit statusMessageChanged();
+    if (message != m_statusMessage) {
+        m_statusMessage = message;
+        emit statusMessageChanged();
+    }
 }
 
 void PkUpdates::setActivity(Activity act)
@@ -21,15 +21,30 @@
 #ifndef PLASMA_PK_UPDATES_H
 #define PLASMA_PK_UPDATES_H
 
+#include <QCache>
 #include <QObject>
 #include <QPointer>
+#include <QDateTime>
+#include <QHash>
+#include <QSet>
+#include <QVariantMap>
 #include <QLoggingCategory>
 
 #include <PackageKit/Daemon>
 #include <PackageKit/Transaction>
 
+#include <KSharedConfig>
+
+#include "pkupdatetable.h"
+
 class QTimer;
-class KNotification;
+class PkUpdatesModel;
+class TransactionQueue;
+class TransactionFactory;
+class UpdatesBroker;
+class PhaseTimings;
+class UpdateScheduler;
+class UpdateNotifier;
 
 Q_DECLARE_LOGGING_CATEGORY(PLASMA_PK_UPDATES)
 
@@ -37,7 +52,7 @@ Q_DECLARE_LOGGING_CATEGORY(PLASMA_PK_UPDATES)
  * @brief The PkUpdates class
  *
  * Backend class to check for available PackageKit system updates.
- * Use checkUpdates() to perform the check, retrieve them with packages()
+ * Use checkUpdates() to perform the check, retrieve them with updatesModel()
  */
 class PkUpdates : public QObject
 {
@@ -51,16 +66,41 @@ class PkUpdates : public QObject
     Q_PROPERTY(int percentage READ percentage NOTIFY percentageChanged)
     Q_PROPERTY(QString timestamp READ timestamp NOTIFY updatesChanged)
     Q_PROPERTY(QString statusMessage READ statusMessage NOTIFY statusMessageChanged)
-    Q_PROPERTY(QVariantMap packages READ packages NOTIFY updatesChanged)
+    Q_PROPERTY(PkUpdatesModel * updatesModel READ updatesModel CONSTANT)
     Q_PROPERTY(bool isActive READ isActive NOTIFY isActiveChanged)
+    Q_PROPERTY(bool isGettingUpdates READ isGettingUpdates NOTIFY isActiveChanged)
     Q_PROPERTY(bool isNetworkOnline READ isNetworkOnline NOTIFY networkStateChanged)
     Q_PROPERTY(bool isNetworkMobile READ isNetworkMobile NOTIFY networkStateChanged)
     Q_PROPERTY(bool isOnBattery READ isOnBattery NOTIFY isOnBatteryChanged)
+    Q_PROPERTY(bool checkAllowed READ checkAllowed NOTIFY checkAllowedChanged)
+    Q_PROPERTY(int startupDelay READ startupDelay WRITE setStartupDelay NOTIFY startupDelayChanged)
+    Q_PROPERTY(int updatesChangedDelay READ updatesChangedDelay WRITE setUpdatesChangedDelay NOTIFY updatesChangedDelayChanged)
+    Q_PROPERTY(int checkInterval READ checkInterval WRITE setCheckInterval NOTIFY checkIntervalChanged)
+    Q_PROPERTY(bool checkOnMobile READ checkOnMobile WRITE setCheckOnMobile NOTIFY checkOnMobileChanged)
+    Q_PROPERTY(bool checkOnBattery READ checkOnBattery WRITE setCheckOnBattery NOTIFY checkOnBatteryChanged)
+    Q_PROPERTY(bool downloadAhead READ downloadAhead WRITE setDownloadAhead NOTIFY downloadAheadChanged)
+    Q_PROPERTY(Urgency urgency READ urgency NOTIFY urgencyChanged)
+    Q_PROPERTY(bool autoInstallSecurity READ autoInstallSecurity WRITE setAutoInstallSecurity NOTIFY autoInstallSecurityChanged)
+    Q_PROPERTY(bool offlineUpdates READ offlineUpdates WRITE setOfflineUpdates NOTIFY offlineUpdatesChanged)
+    Q_PROPERTY(bool updatePrepared READ updatePrepared NOTIFY updatePreparedChanged)
+    Q_PROPERTY(bool updatesDownloaded READ updatesDownloaded NOTIFY updatesDownloadedChanged)
+    Q_PROPERTY(int installStage READ installStage NOTIFY installStageChanged)
+    Q_PROPERTY(int installStageCount READ installStageCount NOTIFY installStageChanged)
+    Q_PROPERTY(bool canResumeInstall READ canResumeInstall NOTIFY installStageChanged)
+    Q_PROPERTY(int queueDepth READ queueDepth NOTIFY queueDepthChanged)
+    Q_PROPERTY(int outstandingTransactions READ outstandingTransactions NOTIFY outstandingTransactionsChanged)
+    Q_PROPERTY(QVariantMap phaseTimings READ phaseTimings NOTIFY phaseTimingsChanged)
+    Q_PROPERTY(bool recordTimings READ recordTimings WRITE setRecordTimings NOTIFY recordTimingsChanged)
+    Q_PROPERTY(int detailsCacheSize READ detailsCacheSize WRITE setDetailsCacheSize NOTIFY detailsCacheSizeChanged)
+    Q_PROPERTY(bool detailsVisible READ detailsVisible WRITE setDetailsVisible NOTIFY detailsVisibleChanged)
 
 public:
-    enum Activity {Idle, CheckingUpdates, GettingUpdates, InstallingUpdates};
+    enum Activity {Idle, CheckingUpdates, GettingUpdates, InstallingUpdates, PreparingUpdates};
     Q_ENUM(Activity)
 
+    enum Urgency {NoUrgency, NormalUrgency, ImportantUrgency, SecurityUrgency};
+    Q_ENUM(Urgency)
+
     explicit PkUpdates(QObject *parent = nullptr);
     ~PkUpdates();
 
@@ -115,9 +155,14 @@ public:
     bool isActive() const;
 
     /**
-     * @return the packages to update (key=packageId, value=description)
+     * @return whether a GetUpdates transaction is streaming the updates into the model
+     */
+    bool isGettingUpdates() const;
+
+    /**
+     * @return the model of packages to update
      */
-    QVariantMap packages() const;
+    PkUpdatesModel * updatesModel() const;
 
     /**
      * @return whether the network is online
@@ -134,6 +179,161 @@ public:
      */
     bool isOnBattery() const;
 
+    /**
+     * @return whether the network and power policy (checkOnMobile, checkOnBattery) allows checking
+     * for and downloading updates in the background
+     */
+    bool checkAllowed() const;
+
+    /**
+     * @return the time (in milliseconds) to wait after startup before connecting to the daemon and
+     * running the first check, unless activate() gets called earlier; 30 seconds by default
+     */
+    int startupDelay() const;
+
+    /**
+     * Set the time to wait after startup before activating, restarts the pending wait
+     * @see startupDelay()
+     */
+    void setStartupDelay(int delay);
+
+    /**
+     * @return the time (in milliseconds) to wait after the daemon reported changed updates before
+     * getting them, so that bursts of notifications result in a single GetUpdates transaction
+     */
+    int updatesChangedDelay() const;
+
+    /**
+     * Set the time to wait after the daemon reported changed updates before getting them
+     * @see updatesChangedDelay()
+     */
+    void setUpdatesChangedDelay(int delay);
+
+    /**
+     * @return the interval (in seconds) of the automatic update checks, 0 if disabled
+     */
+    int checkInterval() const;
+
+    /**
+     * Set the interval (in seconds) of the automatic update checks, 0 disables them
+     */
+    void setCheckInterval(int interval);
+
+    /**
+     * @return whether automatic update checks are allowed on a mobile network connection
+     */
+    bool checkOnMobile() const;
+    void setCheckOnMobile(bool allowed);
+
+    /**
+     * @return whether automatic update checks are allowed when running on battery
+     */
+    bool checkOnBattery() const;
+    void setCheckOnBattery(bool allowed);
+
+    /**
+     * @return whether the update packages get downloaded in the background after each successful
+     * update check, so that installing them later doesn't have to wait for the download
+     */
+    bool downloadAhead() const;
+    void setDownloadAhead(bool enabled);
+
+    /**
+     * @return how urgent installing the available updates is, raised as soon as an important or
+     * security update arrives, even if the check is still running
+     */
+    Urgency urgency() const;
+
+    /**
+     * @return whether security updates get installed automatically, in one staged installation
+     * queued once the update list is complete
+     */
+    bool autoInstallSecurity() const;
+    void setAutoInstallSecurity(bool enabled);
+
+    /**
+     * @return whether all the available updates have been downloaded ahead of installing them
+     */
+    bool updatesDownloaded() const;
+
+    /**
+     * @return whether updates get prepared for being installed on the next restart, see prepareUpdates(),
+     * instead of being installed right away
+     */
+    bool offlineUpdates() const;
+    void setOfflineUpdates(bool enabled);
+
+    /**
+     * @return whether an offline update is prepared, to be installed on the next restart
+     */
+    bool updatePrepared() const;
+
+    /**
+     * @return the batch (1..installStageCount()) of the staged installation being installed, 0 if none
+     * @see installUpdatesStaged()
+     */
+    int installStage() const;
+
+    /**
+     * @return the number of batches of the staged installation, 0 if none
+     */
+    int installStageCount() const;
+
+    /**
+     * @return whether a staged installation failed and can be resumed from the failed batch
+     * @see resumeStagedInstall()
+     */
+    bool canResumeInstall() const;
+
+    /**
+     * @return the number of transactions waiting or running in the backend
+     */
+    int queueDepth() const;
+
+    /**
+     * @return the number of transactions started that haven't been deleted yet, anything above the queue depth
+     * that keeps growing is leaking
+     */
+    int outstandingTransactions() const;
+
+    /**
+     * Start the transactions through @p factory from now on, the daemon itself if nullptr.
+     * The factory isn't owned and has to outlive the transactions it started. If it isn't
+     * the daemon when activated, PkUpdates never follows the daemon, the offline updates
+     * or the power management.
+     */
+    void setTransactionFactory(TransactionFactory *factory);
+
+    /**
+     * @return whether the last check for updates succeeded
+     */
+    bool lastCheckSuccessful() const;
+
+    /**
+     * @return the duration of the last run of each phase of checking and installing, keyed by phase name
+     * ("trigger", "queueWait", "refresh", "getUpdates", "simulate", "download", "install"). Each entry holds
+     * "msecs", "success" and "finished", plus "items" and "itemsPerSecond" where it applies.
+     */
+    QVariantMap phaseTimings() const;
+
+    /**
+     * @return whether the phase timings are appended to a rolling stats file in the cache directory
+     */
+    bool recordTimings() const;
+    void setRecordTimings(bool record);
+
+    /**
+     * @return the number of bytes the fetched update details may take, the least recently used ones get dropped beyond that
+     */
+    int detailsCacheSize() const;
+    void setDetailsCacheSize(int bytes);
+
+    /**
+     * @return whether the update details might be shown, they're all released once this has been false for a while
+     */
+    bool detailsVisible() const;
+    void setDetailsVisible(bool visible);
+
 signals:
     /**
      * Emitted when the number uf updates has changed
@@ -150,11 +350,37 @@ signals:
      */
     void updatesInstalled();
 
+    /**
+     * Emitted when installing updates failed, was declined or given up on
+     */
+    void installFailed();
+
+    /**
+     * Emitted for each update as it's reported by the daemon, before the check is done()
+     * @param packageID the package ID
+     * @param summary the summary of the package
+     * @param severity the PkUpdatesModel::Severity of the update
+     */
+    void updateFound(const QString &packageID, const QString &summary, int severity);
+
+    /**
+     * Emitted for the first important and the first security update of each check, as soon as it arrives
+     * @param packageID the package ID
+     * @param severity the PkUpdatesModel::Severity of the update
+     */
+    void urgentUpdateFound(const QString &packageID, int severity);
+
     /**
      * Emitted with update details
+     * @param packageID the package ID
+     * @param updateText the description of the update
+     * @param urls related bugzilla and CVE URLs
+     * @param changelog the changelog of the update
+     * @param issued when the update was issued
      * @see getUpdateDetails()
      */
-    void updateDetail(const QString &packageID, const QString &updateText, const QStringList &urls);
+    void updateDetail(const QString &packageID, const QString &updateText, const QStringList &urls,
+                      const QString &changelog, const QDateTime &issued);
 
     /**
      * Emitted when an EULA agreement prevents the transaction from running
@@ -173,9 +399,34 @@ signals:
     void percentageChanged();
     void networkStateChanged();
     void isOnBatteryChanged();
+    void checkAllowedChanged();
     void messageChanged();
+    void startupDelayChanged();
+    void updatesChangedDelayChanged();
+    void checkIntervalChanged();
+    void checkOnMobileChanged();
+    void checkOnBatteryChanged();
+    void downloadAheadChanged();
+    void urgencyChanged();
+    void autoInstallSecurityChanged();
+    void updatesDownloadedChanged();
+    void offlineUpdatesChanged();
+    void updatePreparedChanged();
+    void installStageChanged();
+    void queueDepthChanged();
+    void outstandingTransactionsChanged();
+    void phaseTimingsChanged();
+    void recordTimingsChanged();
+    void detailsCacheSizeChanged();
+    void detailsVisibleChanged();
 
 public slots:
+    /**
+      * Connect to the daemon and the session's update broker, then revalidate the cached updates and
+      * start the automatic checks. Happens after startupDelay() or as soon as anything needs the daemon.
+      */
+    Q_INVOKABLE void activate();
+
     /**
       * Perform a cache update, possibly resulting in an update check. Signal updatesChanged() gets emitted
       * as a result. Consult the count() property whether there are new updates available.
@@ -185,13 +436,65 @@ public slots:
       */
     Q_INVOKABLE void checkUpdates(bool force = true, bool manual = false);
 
+    /**
+      * Perform an update check against the existing repository metadata, refreshing the cache first
+      * only if neither we nor anyone else using the daemon did so within the last @p maxCacheAge seconds.
+      * Signal updatesChanged() gets emitted as a result. Unless this is the leader, the leader gets asked
+      * for an unforced check instead, the daemon then decides whether the metadata needs a refresh.
+      *
+      * @param maxCacheAge the maximum age of the repository metadata, in seconds
+      * @param manual whether this check was triggered via explicit user interaction
+      */
+    Q_INVOKABLE void checkUpdatesIfNeeded(qint64 maxCacheAge, bool manual = false);
+
     /**
       * Launch the update process
       *
+      * If the same packages, or the staged installation this is a batch of, were already simulated successfully
+      * and the update list didn't change since, the simulation is skipped and the real transaction started right away.
+      *
       * @param packageIds list of package IDs to update
       */
     Q_INVOKABLE void installUpdates(const QStringList & packageIds, bool simulate = true, bool untrusted = false);
 
+    /**
+      * Launch the update process in batches. Security updates are installed first, then the important
+      * ones and the rest, each batch in its own transaction. All the packages are simulated together once,
+      * which resolves their trust and EULAs for every batch; the batches themselves only go by severity,
+      * the daemon pulls in the dependencies a batch misses. If a batch fails, the batches already
+      * installed are kept and the installation can be continued with resumeStagedInstall().
+      *
+      * @param packageIds list of package IDs to update
+      */
+    Q_INVOKABLE void installUpdatesStaged(const QStringList & packageIds);
+
+    /**
+      * Continue a failed staged installation, starting with the batch that failed
+      */
+    Q_INVOKABLE void resumeStagedInstall();
+
+    /**
+      * Install the packages selected in the updates model in stages, or prepare them when offlineUpdates() is set
+      */
+    Q_INVOKABLE void installSelected();
+
+    /**
+      * Download the packages in the background and prepare them to be installed on the next restart,
+      * outside of the session
+      * @param packageIds list of package IDs to prepare
+      */
+    Q_INVOKABLE void prepareUpdates(const QStringList & packageIds);
+
+    /**
+      * Restart the computer, installing the prepared update on the way
+      */
+    Q_INVOKABLE void restartToUpdate();
+
+    /**
+      * Don't install the prepared update on the next restart
+      */
+    Q_INVOKABLE void cancelPreparedUpdate();
+
     /**
       * @return the timestamp (in milliseconds) of the last cache check, -1 if never
       */
@@ -208,13 +511,21 @@ public slots:
     Q_INVOKABLE static QString packageVersion(const QString & pkgId);
 
     /**
-     * Request details about the details
-     * @param pkgIds Package IDs
+     * Request details about the update, answered from the cache if possible,
+     * otherwise fetched right away together with the pending prefetches
+     * @param pkgID Package ID
      *
      * Emits updateDetail()
      */
     Q_INVOKABLE void getUpdateDetails(const QString & pkgID);
 
+    /**
+     * Queue the update details of the package to be fetched in the background,
+     * batched with other prefetches into a single transaction. Does not emit updateDetail().
+     * @param pkgID Package ID
+     */
+    Q_INVOKABLE void prefetchUpdateDetails(const QString & pkgID);
+
     Q_INVOKABLE void doDelayedCheckUpdates();
 
     /**
@@ -240,6 +551,21 @@ private slots:
     void onRepoSignatureRequired(const QString & packageID, const QString & repoName, const QString & keyUrl, const QString & keyUserid,
                                  const QString & keyId, const QString & keyFingerprint, const QString & keyTimestamp, PackageKit::Transaction::SigType type);
     void onEulaRequired(const QString &eulaID, const QString &packageID, const QString &vendor, const QString &licenseAgreement);
+    void onCheckDue();
+    void onLeaderChanged();
+    void onBrokerUpdates(const PkUpdateTable &updates);
+    void onBrokerPublication(bool lastCheckSuccessful, bool checkPending);
+    void onBrokerStatus(uint networkState, bool updatePrepared);
+    void onBrokerCheckFailed();
+    void fetchUpdateDetails();
+    void downloadUpdates();
+    void onProgressTimeout();
+    void publishPendingUpdates();
+    void syncConfig();
+    void onNetworkStateChanged();
+    void onOfflineChanged();
+    void restart(PackageKit::Transaction::Restart type);
+    void setOnBattery(bool onBattery);
 
 private:
     struct EulaData {
@@ -248,28 +574,159 @@ private:
         QString licenseAgreement;
     };
 
+    struct UpdateDetail {
+        QString updateText;
+        // big changelogs are kept compressed instead
+        QString changelog;
+        QByteArray compressedChangelog;
+        QStringList urls;
+        QDateTime issued;
+
+        QString changelogText() const;
+        int cost() const;
+    };
+
+    bool backgroundNetworkAllowed() const;
+    void updateCheckAllowed();
+    // watched by the leader only, the subscribers get the network and offline state from it
+    void connectDaemon();
+    void setNetworkState(PackageKit::Daemon::Network state);
+    void setUpdatePrepared(bool prepared);
+    void publishStatus();
+    void updateUrgency();
+    void setUrgency(Urgency urgency);
+    void queueSecurityInstall(const PkUpdateTable &updates);
+    void startStagedInstall(const QStringList &packageIds, bool automatic);
+    void scheduleGetUpdates();
+    void onGetUpdatesFinished(PackageKit::Transaction::Exit status);
+    bool loadCache();
+    // @p checked is the LastCheck entry of the config stored along with the list
+    void saveCache(qint64 checked) const;
+    void scheduleProgressUpdate();
+    void updateProgress();
     void setStatusMessage(const QString &message);
     void setActivity(Activity act);
     void setPercentage(int value);
     void showError(PackageKit::Transaction::Error error, const QString &details);
+    // false until activated, or while subscribed to another instance
+    bool isLeader() const;
     void promptNextEulaAgreement();
+    PackageKit::Transaction * startDownloadUpdates();
+    // the daemon, unless replaced by setTransactionFactory()
+    TransactionFactory * transactions() const;
+    // counts @p trans as outstanding until it gets deleted
+    PackageKit::Transaction * track(PackageKit::Transaction *trans);
+    void clearStagedInstall();
+    void installSimulated(bool untrusted);
+    void rememberSimulation(const QStringList &packageIds, bool untrusted, const QSet<QString> &eulas = QSet<QString>());
+    bool isSimulated(const QStringList &packageIds) const;
+    void pruneUpdateDetails();
+    void loadRefreshState();
+    void storeRefreshState(qint64 timestamp, int failedAutoRefreshCount);
+    void storeCheckTimestamp(qint64 timestamp);
+    void scheduleConfigSync();
     QPointer<PackageKit::Transaction> m_updatesTrans;
     QPointer<PackageKit::Transaction> m_cacheTrans;
     QPointer<PackageKit::Transaction> m_installTrans;
-    QPointer<PackageKit::Transaction> m_detailTrans;
     QPointer<PackageKit::Transaction> m_eulaTrans;
+    QPointer<PackageKit::Transaction> m_downloadTrans;
+    QPointer<PackageKit::Transaction> m_prepareTrans;
+    int m_outstandingTransactions = 0;
+    TransactionFactory * m_daemonTransactions;
+    QPointer<TransactionFactory> m_transactionFactory;
+    // the flags m_installTrans was started with
+    PackageKit::Transaction::TransactionFlags m_installFlags;
+    bool m_offlineUpdates = false;
+    bool m_updatePrepared = false;
     QStringList m_packages;
-    QPointer<KNotification> m_lastNotification;
-    int m_lastUpdateCount = 0;
-    QVariantMap m_updateList;
-    QStringList m_importantList;
-    QStringList m_securityList;
+    KSharedConfigPtr m_config;
+    // flushes the config writes in batches
+    QTimer * m_configSyncTimer;
+    QTimer * m_startupTimer;
+    bool m_activated = false;
+    bool m_daemonConnected = false;
+    // cached Timestamp and FailedAutoRefeshCount config entries
+    qint64 m_lastRefresh = -1;
+    int m_failedAutoRefreshCount = 0;
+    PkUpdatesModel * m_updatesModel;
+    // updates received from the running GetUpdates transaction
+    PkUpdateTable m_pendingUpdates;
+    // number of m_pendingUpdates already merged into the model, and the timer publishing the rest
+    int m_publishedRows = 0;
+    QTimer * m_publishTimer;
+    // coalesces the daemon's updatesChanged() notifications
+    QTimer * m_getUpdatesTimer;
+    // whether updates changed again while GetUpdates was running
+    bool m_getUpdatesQueued = false;
+    // whether the next run of getUpdates() belongs to a check the user asked for
+    bool m_getUpdatesManual = false;
+    UpdateScheduler * m_scheduler;
+    TransactionQueue * m_queue;
+    UpdatesBroker * m_broker = nullptr;
+    PhaseTimings * m_timings;
+    UpdateNotifier * m_notifier;
+    // the transaction waiting for the daemon, if any
+    QPointer<PackageKit::Transaction> m_waitingTrans;
+    bool m_checkOnMobile = false;
+    bool m_checkOnBattery = false;
+    bool m_downloadAhead = false;
+    Urgency m_urgency = NoUrgency;
+    // the highest severity received from the running GetUpdates transaction
+    int m_streamSeverity = PkUpdateTable::NormalSeverity;
+    bool m_autoInstallSecurity = false;
+    // whether the staged install was started by us rather than the user, and its packages
+    bool m_autoInstalling = false;
+    QStringList m_autoInstallIds;
+    // installed automatically once already, not retried by the checks following the failure
+    QSet<QString> m_autoInstallAttempted;
+    // the update list generation whose packages were all downloaded ahead
+    quint64 m_downloadedGeneration = 0;
+    bool m_updatesDownloaded = false;
+    // batches of the staged installation, the one being installed, and whether it failed
+    QList<QStringList> m_stagedBatches;
+    int m_stagedBatch = 0;
+    QStringList m_stagedPackages;
+    // simulating all of m_stagedPackages before the first batch, and whether that's done; the batches are
+    // then installed without being simulated each, even if the update list changes in between
+    bool m_stagedSimulating = false;
+    bool m_stagedSimulated = false;
+    bool m_stagedFailed = false;
+    // the (sorted) packages of the last successful simulation, and the update list generation it applies to
+    QStringList m_simulatedPackages;
+    quint64 m_simulatedGeneration = 0;
+    bool m_simulatedUntrusted = false;
+    // the EULAs the last simulation asked for, it holds once they're all accepted
+    QSet<QString> m_simulatedEulas;
+    QSet<QString> m_acceptedEulas;
+    // update details by package ID, valid as long as the package is in the update list; costs are in bytes
+    QCache<QString, UpdateDetail> m_updateDetails;
+    quint64 m_updateDetailsGeneration = 0;
+    // IDs to fetch with the next batch, and those being fetched
+    QStringList m_pendingDetails;
+    QSet<QString> m_detailsInFlight;
+    // IDs for which updateDetail() should be emitted once fetched
+    QSet<QString> m_requestedDetails;
+    QTimer * m_detailsTimer;
+    bool m_detailsVisible = false;
+    QTimer * m_detailsReleaseTimer;
+    // the latest progress reported by a transaction, shown at most once per s_progressInterval
+    QPointer<PackageKit::Transaction> m_progressTrans;
+    bool m_progressForPackage = false;
+    PackageKit::Transaction::Info m_progressInfo = PackageKit::Transaction::InfoUnknown;
+    QString m_progressPackageID;
+    bool m_progressPending = false;
+    QTimer * m_progressTimer;
     QString m_statusMessage;
     int m_percentage = 0;
     Activity m_activity = Idle;
+    // what to go back to when a check forwarded to the leader fails
+    Activity m_activityBeforeBrokerCheck = Idle;
     bool m_lastCheckSuccessful = false;
     bool m_checkUpdatesWhenNetworkOnline = false;
     bool m_isOnBattery;
+    // snapshot of the daemon's network state, updated on networkStateChanged(); assumed online until activated
+    PackageKit::Daemon::Network m_networkState = PackageKit::Daemon::NetworkOnline;
+    bool m_checkAllowed = false;
     // If the current check was triggered manually
     bool m_isManualCheck;
     // If a transaction failed because of required EULAs,
@@ -0,0 +1,581 @@
+/***************************************************************************
+ *   Copyright (C) 2026 agent <agent@local>                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; see the file COPYING. If not, write to       *
+ *   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,  *
+ *   Boston, MA 02110-1301, USA.                                           *
+ ***************************************************************************/
+
+#include <algorithm>
+
+#include "pkupdatesfiltermodel.h"
+
+namespace
+{
+    const int s_trigramLength = 3;
+
+    quint64 trigramAt(const QString &text, int pos)
+    {
+        return (quint64(text.at(pos).unicode()) << 32) | (quint64(text.at(pos + 1).unicode()) << 16) | text.at(pos + 2).unicode();
+    }
+} // namespace {
+
+PkUpdatesFilterModel::PkUpdatesFilterModel(QObject *parent) :
+    QSortFilterProxyModel(parent)
+{
+    connect(this, &QAbstractItemModel::rowsInserted, this, &PkUpdatesFilterModel::countChanged);
+    connect(this, &QAbstractItemModel::rowsRemoved, this, &PkUpdatesFilterModel::countChanged);
+    connect(this, &QAbstractItemModel::modelReset, this, &PkUpdatesFilterModel::countChanged);
+    connect(this, &QAbstractItemModel::layoutChanged, this, &PkUpdatesFilterModel::countChanged);
+}
+
+PkUpdatesFilterModel::~PkUpdatesFilterModel()
+{
+}
+
+PkUpdatesModel * PkUpdatesFilterModel::updatesModel() const
+{
+    return m_updatesModel;
+}
+
+void PkUpdatesFilterModel::setUpdatesModel(PkUpdatesModel * model)
+{
+    if (model == m_updatesModel)
+        return;
+
+    if (m_updatesModel) {
+        disconnect(m_updatesModel, &QAbstractItemModel::modelReset, this, &PkUpdatesFilterModel::onSourceChanged);
+        disconnect(m_updatesModel, &QAbstractItemModel::rowsInserted, this, &PkUpdatesFilterModel::onSourceRowsInserted);
+        disconnect(m_updatesModel, &QAbstractItemModel::rowsRemoved, this, &PkUpdatesFilterModel::onSourceRowsRemoved);
+        disconnect(m_updatesModel, &QAbstractItemModel::layoutChanged, this, &PkUpdatesFilterModel::onSourceChanged);
+        disconnect(m_updatesModel, &QAbstractItemModel::dataChanged, this, &PkUpdatesFilterModel::onSourceDataChanged);
+    }
+
+    m_updatesModel = model;
+    m_indexDirty = true;
+    m_acceptedDirty = true;
+
+    // connected before the proxy itself, so that the index is up to date before the proxy filters the changed rows
+    if (m_updatesModel) {
+        connect(m_updatesModel, &QAbstractItemModel::modelReset, this, &PkUpdatesFilterModel::onSourceChanged);
+        connect(m_updatesModel, &QAbstractItemModel::rowsInserted, this, &PkUpdatesFilterModel::onSourceRowsInserted);
+        connect(m_updatesModel, &QAbstractItemModel::rowsRemoved, this, &PkUpdatesFilterModel::onSourceRowsRemoved);
+        connect(m_updatesModel, &QAbstractItemModel::layoutChanged, this, &PkUpdatesFilterModel::onSourceChanged);
+        connect(m_updatesModel, &QAbstractItemModel::dataChanged, this, &PkUpdatesFilterModel::onSourceDataChanged);
+    }
+    setSourceModel(m_updatesModel);
+
+    emit updatesModelChanged();
+    emit indexChanged();
+    emit countChanged();
+}
+
+QString PkUpdatesFilterModel::filterText() const
+{
+    return m_filterText;
+}
+
+void PkUpdatesFilterModel::setFilterText(const QString &text)
+{
+    const QString filterText = text.trimmed();
+    if (filterText != m_filterText) {
+        m_filterText = filterText;
+        refilter();
+        emit filterTextChanged();
+    }
+}
+
+int PkUpdatesFilterModel::severityFilter() const
+{
+    return m_severityFilter;
+}
+
+void PkUpdatesFilterModel::setSeverityFilter(int severities)
+{
+    severities &= AllSeverities;
+    if (severities != m_severityFilter) {
+        m_severityFilter = severities;
+        refilter();
+        emit severityFilterChanged();
+    }
+}
+
+QString PkUpdatesFilterModel::repoFilter() const
+{
+    return m_repoFilter;
+}
+
+void PkUpdatesFilterModel::setRepoFilter(const QString &repo)
+{
+    if (repo != m_repoFilter) {
+        m_repoFilter = repo;
+        refilter();
+        emit repoFilterChanged();
+    }
+}
+
+QString PkUpdatesFilterModel::archFilter() const
+{
+    return m_archFilter;
+}
+
+void PkUpdatesFilterModel::setArchFilter(const QString &arch)
+{
+    if (arch != m_archFilter) {
+        m_archFilter = arch;
+        refilter();
+        emit archFilterChanged();
+    }
+}
+
+QStringList PkUpdatesFilterModel::repos() const
+{
+    ensureIndex();
+    return m_repos;
+}
+
+QStringList PkUpdatesFilterModel::arches() const
+{
+    ensureIndex();
+    return m_arches;
+}
+
+int PkUpdatesFilterModel::count() const
+{
+    return rowCount();
+}
+
+bool PkUpdatesFilterModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+{
+    if (sourceParent.isValid())
+        return false;
+    if (!isFiltering())
+        return true;
+
+    updateAccepted();
+    return sourceRow < m_accepted.size() && m_accepted.testBit(sourceRow);
+}
+
+void PkUpdatesFilterModel::onSourceChanged()
+{
+    m_indexDirty = true;
+    m_acceptedDirty = true;
+    emit indexChanged();
+}
+
+void PkUpdatesFilterModel::onSourceRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if (m_indexDirty || parent.isValid())
+        return;
+
+    ensureIndex();
+    // the updates only get appended, rows inserted anywhere else would shift the whole index
+    const int rows = m_severityRows[PkUpdateTable::NormalSeverity].size();
+    if (first != rows || last + 1 != m_updatesModel->updates().count()) {
+        onSourceChanged();
+        return;
+    }
+
+    for (QBitArray &severityRows : m_severityRows)
+        severityRows.resize(last + 1);
+    for (QBitArray &repoRows : m_repoRows)
+        repoRows.resize(last + 1);
+    for (QBitArray &archRows : m_archRows)
+        archRows.resize(last + 1);
+    if (!m_acceptedDirty)
+        m_accepted.resize(last + 1);
+
+    const PkUpdateTable &updates = m_updatesModel->updates();
+    const int names = m_names.count();
+    bool valuesChanged = false;
+    for (int row = first; row <= last; ++row) {
+        valuesChanged |= indexRow(row);
+        m_names << qMakePair(updates.name(row).toLower(), row);
+        if (m_trigramsBuilt)
+            indexTrigrams(row);
+        if (!m_acceptedDirty)
+            m_accepted.setBit(row, acceptsRow(row));
+    }
+    std::sort(m_names.begin() + names, m_names.end());
+    std::inplace_merge(m_names.begin(), m_names.begin() + names, m_names.end());
+
+    if (valuesChanged)
+        emit indexChanged();
+}
+
+void PkUpdatesFilterModel::onSourceRowsRemoved(const QModelIndex &parent, int first, int last)
+{
+    if (m_indexDirty || parent.isValid())
+        return;
+
+    // the rows only get marked here, a merge removes many ranges and shifting the index for each would
+    // cost a pass over all the rows per range
+    const int rows = m_severityRows[PkUpdateTable::NormalSeverity].size();
+    if (m_removedRows.isEmpty()) {
+        m_removedRows.fill(false, rows);
+        m_keptRows.resize(rows + 1);
+        for (int i = 1; i <= rows; ++i)
+            m_keptRows[i] = i & -i;
+        QMetaObject::invokeMethod(this, "flushRemovals", Qt::QueuedConnection);
+    }
+
+    int highestStep = 1;
+    while (highestStep * 2 <= rows)
+        highestStep *= 2;
+
+    // each removal shifts the next row of the range to first, find the first-th row still kept each time
+    for (int removed = first; removed <= last; ++removed) {
+        int row = 0;
+        int rank = first + 1;
+        for (int step = highestStep; step; step /= 2) {
+            if (row + step <= rows && m_keptRows.at(row + step) < rank) {
+                row += step;
+                rank -= m_keptRows.at(row);
+            }
+        }
+
+        if (row >= rows) {
+            onSourceChanged();
+            return;
+        }
+        m_removedRows.setBit(row);
+        for (int i = row + 1; i <= rows; i += i & -i)
+            --m_keptRows[i];
+    }
+}
+
+void PkUpdatesFilterModel::onSourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles)
+{
+    // (de)selecting doesn't change what's indexed
+    if (roles.count() == 1 && roles.first() == PkUpdatesModel::SelectedRole)
+        return;
+    if (m_indexDirty || topLeft.parent().isValid())
+        return;
+
+    ensureIndex();
+    // the model replaces the rows of the same name and arch, so the sorted names stay as they are
+    const int rows = m_severityRows[PkUpdateTable::NormalSeverity].size();
+    bool valuesChanged = false;
+    for (int row = topLeft.row(); row <= bottomRight.row() && row < rows; ++row) {
+        valuesChanged |= indexRow(row);
+        if (m_trigramsBuilt) {
+            indexTrigrams(row);
+            ++m_staleTrigramRows;
+        }
+        if (!m_acceptedDirty)
+            m_accepted.setBit(row, acceptsRow(row));
+    }
+
+    // rebuilt on the next text filter, before the old trigrams make up most of the candidates
+    if (m_trigramsBuilt && m_staleTrigramRows > rows / 2) {
+        m_trigrams.clear();
+        m_trigramsBuilt = false;
+    }
+
+    if (valuesChanged)
+        emit indexChanged();
+}
+
+void PkUpdatesFilterModel::flushRemovals()
+{
+    ensureIndex();
+    if (m_valuesChanged) {
+        m_valuesChanged = false;
+        emit indexChanged();
+    }
+}
+
+bool PkUpdatesFilterModel::isFiltering() const
+{
+    return !m_filterText.isEmpty() || m_severityFilter != AllSeverities || !m_repoFilter.isEmpty() || !m_archFilter.isEmpty();
+}
+
+void PkUpdatesFilterModel::ensureIndex() const
+{
+    if (!m_indexDirty) {
+        applyRemovals();
+        return;
+    }
+
+    m_indexDirty = false;
+    m_acceptedDirty = true;
+    m_valuesChanged = false;
+    m_repos.clear();
+    m_repoIds.clear();
+    m_repoRows.clear();
+    m_arches.clear();
+    m_archIds.clear();
+    m_archRows.clear();
+    m_names.clear();
+    m_trigrams.clear();
+    m_trigramsBuilt = false;
+    m_removedRows.clear();
+    m_keptRows.clear();
+
+    const int rows = m_updatesModel ? m_updatesModel->updates().count() : 0;
+    for (QBitArray &severityRows : m_severityRows)
+        severityRows.fill(false, rows);
+    if (!rows)
+        return;
+
+    const PkUpdateTable &updates = m_updatesModel->updates();
+    m_names.reserve(rows);
+    for (int row = 0; row < rows; ++row) {
+        indexRow(row);
+        m_names << qMakePair(updates.name(row).toLower(), row);
+    }
+    std::sort(m_names.begin(), m_names.end());
+}
+
+void PkUpdatesFilterModel::applyRemovals() const
+{
+    if (m_removedRows.isEmpty())
+        return;
+
+    const int rows = m_removedRows.size();
+    QVector<int> newRows(rows);
+    int kept = 0;
+    for (int row = 0; row < rows; ++row)
+        newRows[row] = m_removedRows.testBit(row) ? -1 : kept++;
+    m_removedRows.clear();
+    m_keptRows.clear();
+
+    const auto compact = [&newRows, kept](QBitArray &bits) {
+        QBitArray compacted(kept);
+        for (int row = 0; row < bits.size(); ++row) {
+            if (bits.testBit(row) && newRows.at(row) != -1)
+                compacted.setBit(newRows.at(row));
+        }
+        bits = compacted;
+    };
+    for (QBitArray &severityRows : m_severityRows)
+        compact(severityRows);
+    for (QBitArray &repoRows : m_repoRows)
+        compact(repoRows);
+    for (QBitArray &archRows : m_archRows)
+        compact(archRows);
+    if (m_accepted.size() == rows)
+        compact(m_accepted);
+
+    // the repositories and arches left without updates
+    const auto prune = [](QStringList &values, QHash<QString, int> &ids, QVector<QBitArray> &valueRows) {
+        bool pruned = false;
+        for (int id = values.count() - 1; id >= 0; --id) {
+            if (!valueRows.at(id).count(true)) {
+                values.removeAt(id);
+                valueRows.remove(id);
+                pruned = true;
+            }
+        }
+        if (pruned) {
+            ids.clear();
+            for (int id = 0; id < values.count(); ++id)
+                ids.insert(values.at(id), id);
+        }
+        return pruned;
+    };
+    if (prune(m_repos, m_repoIds, m_repoRows))
+        m_valuesChanged = true;
+    if (prune(m_arches, m_archIds, m_archRows))
+        m_valuesChanged = true;
+
+    // the kept rows keep their order, so the names and trigram rows stay sorted
+    int to = 0;
+    for (int from = 0; from < m_names.count(); ++from) {
+        const int row = newRows.at(m_names.at(from).second);
+        if (row != -1) {
+            m_names[to] = qMakePair(m_names.at(from).first, row);
+            ++to;
+        }
+    }
+    m_names.resize(to);
+
+    for (auto it = m_trigrams.begin(); it != m_trigrams.end();) {
+        QVector<int> &trigramRows = it.value();
+        to = 0;
+        for (int from = 0; from < trigramRows.count(); ++from) {
+            const int row = newRows.at(trigramRows.at(from));
+            if (row != -1)
+                trigramRows[to++] = row;
+        }
+        if (to) {
+            trigramRows.resize(to);
+            ++it;
+        } else {
+            it = m_trigrams.erase(it);
+        }
+    }
+}
+
+bool PkUpdatesFilterModel::indexRow(int row) const
+{
+    const PkUpdateTable &updates = m_updatesModel->updates();
+    for (int severity = 0; severity < PkUpdateTable::SeverityCount; ++severity)
+        m_severityRows[severity].setBit(row, severity == updates.severity(row));
+
+    const bool reposChanged = setRowValue(row, updates.data(row), m_repos, m_repoIds, m_repoRows);
+    const bool archesChanged = setRowValue(row, updates.arch(row), m_arches, m_archIds, m_archRows);
+    return reposChanged || archesChanged;
+}
+
+bool PkUpdatesFilterModel::setRowValue(int row, const QString &value, QStringList &values, QHash<QString, int> &ids,
+                                       QVector<QBitArray> &valueRows) const
+{
+    int oldId = -1;
+    for (int id = 0; id < valueRows.count() && oldId == -1; ++id) {
+        if (valueRows.at(id).testBit(row))
+            oldId = id;
+    }
+    if (oldId != -1 && values.at(oldId) == value)
+        return false;
+
+    bool changed = false;
+    if (oldId != -1) {
+        valueRows[oldId].clearBit(row);
+        if (!valueRows.at(oldId).count(true)) {
+            values.removeAt(oldId);
+            valueRows.remove(oldId);
+            ids.clear();
+            for (int id = 0; id < values.count(); ++id)
+                ids.insert(values.at(id), id);
+            changed = true;
+        }
+    }
+
+    int id = ids.value(value, -1);
+    if (id == -1) {
+        id = values.count();
+        ids.insert(value, id);
+        values << value;
+        valueRows << QBitArray(m_severityRows[PkUpdateTable::NormalSeverity].size());
+        changed = true;
+    }
+    valueRows[id].setBit(row);
+    return changed;
+}
+
+void PkUpdatesFilterModel::indexTrigrams(int row) const
+{
+    const PkUpdateTable &updates = m_updatesModel->updates();
+    const QString text = updates.name(row).toLower() + QLatin1Char('\n') + updates.summary(row).toLower();
+    for (int pos = 0; pos + s_trigramLength <= text.size(); ++pos) {
+        QVector<int> &rows = m_trigrams[trigramAt(text, pos)];
+        // the rows mostly get indexed in order, this also skips the repeated trigrams of a row
+        if (rows.isEmpty() || rows.last() < row) {
+            rows << row;
+        } else {
+            const auto it = std::lower_bound(rows.begin(), rows.end(), row);
+            if (*it != row)
+                rows.insert(it, row);
+        }
+    }
+}
+
+void PkUpdatesFilterModel::buildTrigrams() const
+{
+    if (m_trigramsBuilt)
+        return;
+
+    m_trigramsBuilt = true;
+    m_staleTrigramRows = 0;
+    for (int row = 0; row < m_updatesModel->updates().count(); ++row)
+        indexTrigrams(row);
+}
+
+bool PkUpdatesFilterModel::acceptsRow(int row) const
+{
+    const PkUpdateTable &updates = m_updatesModel->updates();
+    if (!(m_severityFilter & (1 << updates.severity(row))))
+        return false;
+    if (!m_repoFilter.isEmpty() && updates.data(row) != m_repoFilter)
+        return false;
+    if (!m_archFilter.isEmpty() && updates.arch(row) != m_archFilter)
+        return false;
+
+    if (m_filterText.isEmpty())
+        return true;
+    if (m_filterText.size() < s_trigramLength)
+        return updates.name(row).toLower().startsWith(m_filterText.toLower());
+    return updates.name(row).contains(m_filterText, Qt::CaseInsensitive) ||
+            updates.summary(row).contains(m_filterText, Qt::CaseInsensitive);
+}
+
+QBitArray PkUpdatesFilterModel::textMatches() const
+{
+    const PkUpdateTable &updates = m_updatesModel->updates();
+    QBitArray matches(updates.count());
+    const QString text = m_filterText.toLower();
+
+    if (text.size() < s_trigramLength) {
+        auto it = std::lower_bound(m_names.constBegin(), m_names.constEnd(), qMakePair(text, -1));
+        for (; it != m_names.constEnd() && it->first.startsWith(text); ++it)
+            matches.setBit(it->second);
+        return matches;
+    }
+
+    buildTrigrams();
+
+    // the rows containing all the trigrams are candidates, check those of the rarest one
+    const QVector<int> * candidates = nullptr;
+    for (int pos = 0; pos + s_trigramLength <= text.size(); ++pos) {
+        const auto it = m_trigrams.constFind(trigramAt(text, pos));
+        if (it == m_trigrams.constEnd())
+            return matches;
+        if (!candidates || it->count() < candidates->count())
+            candidates = &it.value();
+    }
+
+    for (int row : *candidates) {
+        if (updates.name(row).contains(m_filterText, Qt::CaseInsensitive) ||
+                updates.summary(row).contains(m_filterText, Qt::CaseInsensitive))
+            matches.setBit(row);
+    }
+    return matches;
+}
+
+void PkUpdatesFilterModel::updateAccepted() const
+{
+    ensureIndex();
+    if (!m_acceptedDirty)
+        return;
+
+    m_acceptedDirty = false;
+    const int rows = m_severityRows[PkUpdateTable::NormalSeverity].size();
+    QBitArray accepted(rows);
+    for (int severity = 0; severity < PkUpdateTable::SeverityCount; ++severity) {
+        if (m_severityFilter & (1 << severity))
+            accepted |= m_severityRows[severity];
+    }
+
+    if (!m_repoFilter.isEmpty()) {
+        const int repoId = m_repos.indexOf(m_repoFilter);
+        accepted &= repoId == -1 ? QBitArray(rows) : m_repoRows.at(repoId);
+    }
+
+    if (!m_archFilter.isEmpty()) {
+        const int archId = m_arches.indexOf(m_archFilter);
+        accepted &= archId == -1 ? QBitArray(rows) : m_archRows.at(archId);
+    }
+
+    if (!m_filterText.isEmpty() && rows)
+        accepted &= textMatches();
+
+    m_accepted = accepted;
+}
+
+void PkUpdatesFilterModel::refilter()
+{
+    m_acceptedDirty = true;
+    invalidateFilter();
+}
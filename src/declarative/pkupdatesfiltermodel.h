@@ -0,0 +1,179 @@
+/***************************************************************************
+ *   Copyright (C) 2026 agent <agent@local>                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; see the file COPYING. If not, write to       *
+ *   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,  *
+ *   Boston, MA 02110-1301, USA.                                           *
+ ***************************************************************************/
+
+#ifndef PLASMA_PK_UPDATES_FILTER_MODEL_H
+#define PLASMA_PK_UPDATES_FILTER_MODEL_H
+
+#include <QBitArray>
+#include <QHash>
+#include <QPointer>
+#include <QSortFilterProxyModel>
+#include <QStringList>
+#include <QVector>
+
+#include "pkupdatesmodel.h"
+
+/**
+ * @brief The PkUpdatesFilterModel class
+ *
+ * Filters a PkUpdatesModel by text, severity, repository and arch without
+ * scanning all the rows on each change of the filter. The rows of each
+ * severity, repository and arch are kept as bitmaps, and the name and
+ * summary of each row are indexed by their trigrams, so that only the rows
+ * containing all the trigrams of the text get checked. Texts shorter than a
+ * trigram match the beginning of the package name, looked up in a sorted
+ * index of the names.
+ *
+ * The index is built on first use and then follows the changes of the
+ * updates: appended rows get indexed, rows changed in place re-indexed, and
+ * the rows removed by a merge are dropped from the index in a single pass.
+ * Only a reset or a layout change rebuilds it.
+ */
+class PkUpdatesFilterModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+    Q_PROPERTY(PkUpdatesModel * updatesModel READ updatesModel WRITE setUpdatesModel NOTIFY updatesModelChanged)
+    Q_PROPERTY(QString filterText READ filterText WRITE setFilterText NOTIFY filterTextChanged)
+    Q_PROPERTY(int severityFilter READ severityFilter WRITE setSeverityFilter NOTIFY severityFilterChanged)
+    Q_PROPERTY(QString repoFilter READ repoFilter WRITE setRepoFilter NOTIFY repoFilterChanged)
+    Q_PROPERTY(QString archFilter READ archFilter WRITE setArchFilter NOTIFY archFilterChanged)
+    Q_PROPERTY(QStringList repos READ repos NOTIFY indexChanged)
+    Q_PROPERTY(QStringList arches READ arches NOTIFY indexChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+public:
+    enum SeverityFlag {
+        NormalFlag = 1 << PkUpdateTable::NormalSeverity,
+        ImportantFlag = 1 << PkUpdateTable::ImportantSeverity,
+        SecurityFlag = 1 << PkUpdateTable::SecuritySeverity,
+        AllSeverities = NormalFlag | ImportantFlag | SecurityFlag
+    };
+    Q_ENUM(SeverityFlag)
+
+    explicit PkUpdatesFilterModel(QObject *parent = nullptr);
+    ~PkUpdatesFilterModel();
+
+    PkUpdatesModel * updatesModel() const;
+    void setUpdatesModel(PkUpdatesModel * model);
+
+    /**
+     * @return the text the name or summary of the shown updates contain, case insensitive; shorter than three
+     * characters it's a prefix of the name
+     */
+    QString filterText() const;
+    void setFilterText(const QString &text);
+
+    /**
+     * @return the SeverityFlag combination of the shown updates
+     */
+    int severityFilter() const;
+    void setSeverityFilter(int severities);
+
+    /**
+     * @return the repository of the shown updates, all if empty
+     */
+    QString repoFilter() const;
+    void setRepoFilter(const QString &repo);
+
+    /**
+     * @return the arch of the shown updates, all if empty
+     */
+    QString archFilter() const;
+    void setArchFilter(const QString &arch);
+
+    /**
+     * @return the repositories of all the updates
+     */
+    QStringList repos() const;
+
+    /**
+     * @return the arches of all the updates
+     */
+    QStringList arches() const;
+
+    /**
+     * @return the number of updates shown
+     */
+    int count() const;
+
+signals:
+    void updatesModelChanged();
+    void filterTextChanged();
+    void severityFilterChanged();
+    void repoFilterChanged();
+    void archFilterChanged();
+    void indexChanged();
+    void countChanged();
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const Q_DECL_OVERRIDE;
+
+private slots:
+    void onSourceChanged();
+    void onSourceRowsInserted(const QModelIndex &parent, int first, int last);
+    void onSourceRowsRemoved(const QModelIndex &parent, int first, int last);
+    void onSourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles);
+    void flushRemovals();
+
+private:
+    bool isFiltering() const;
+    void ensureIndex() const;
+    void applyRemovals() const;
+    bool indexRow(int row) const;
+    bool setRowValue(int row, const QString &value, QStringList &values, QHash<QString, int> &ids, QVector<QBitArray> &valueRows) const;
+    void indexTrigrams(int row) const;
+    void buildTrigrams() const;
+    bool acceptsRow(int row) const;
+    QBitArray textMatches() const;
+    void updateAccepted() const;
+    void refilter();
+
+    QPointer<PkUpdatesModel> m_updatesModel;
+    QString m_filterText;
+    int m_severityFilter = AllSeverities;
+    QString m_repoFilter;
+    QString m_archFilter;
+
+    // built lazily, from the updates of the source model
+    mutable bool m_indexDirty = true;
+    mutable bool m_acceptedDirty = true;
+    mutable QBitArray m_severityRows[PkUpdateTable::SeverityCount];
+    mutable QStringList m_repos;
+    mutable QHash<QString, int> m_repoIds;
+    mutable QVector<QBitArray> m_repoRows;
+    mutable QStringList m_arches;
+    mutable QHash<QString, int> m_archIds;
+    mutable QVector<QBitArray> m_archRows;
+    // whether m_repos or m_arches changed while dropping removed rows, reported by flushRemovals()
+    mutable bool m_valuesChanged = false;
+    // lower case names with their row, sorted
+    mutable QVector<QPair<QString, int>> m_names;
+    // rows containing each trigram of the lower case name and summary, built on the first text filter
+    mutable QHash<quint64, QVector<int>> m_trigrams;
+    mutable bool m_trigramsBuilt = false;
+    // rows re-indexed since the trigrams were built, their old trigrams still point at them
+    mutable int m_staleTrigramRows = 0;
+    // the rows passing all the filters
+    mutable QBitArray m_accepted;
+    // rows removed from the source but still in the index, and a Fenwick tree counting the others
+    mutable QBitArray m_removedRows;
+    mutable QVector<int> m_keptRows;
+};
+
+#endif // PLASMA_PK_UPDATES_FILTER_MODEL_H
@@ -0,0 +1,406 @@
+/***************************************************************************
+ *   Copyright (C) 2026 agent <agent@local>                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; see the file COPYING. If not, write to       *
+ *   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,  *
+ *   Boston, MA 02110-1301, USA.                                           *
+ ***************************************************************************/
+
+#include <QHash>
+
+#include "pkupdatesmodel.h"
+
+PkUpdatesModel::PkUpdatesModel(QObject *parent) :
+    QAbstractListModel(parent)
+{
+}
+
+PkUpdatesModel::~PkUpdatesModel()
+{
+}
+
+int PkUpdatesModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return count();
+}
+
+QVariant PkUpdatesModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= count())
+        return QVariant();
+
+    const int row = tableRow(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+    case NameRole:
+        return m_updates.name(row);
+    case IdRole:
+        return m_updates.packageId(row);
+    case VersionRole:
+        return m_updates.version(row);
+    case ArchRole:
+        return m_updates.arch(row);
+    case RepoRole:
+        return m_updates.data(row);
+    case SummaryRole:
+        return m_updates.summary(row);
+    case SeverityRole:
+        return m_updates.severity(row);
+    case SelectedRole:
+        return m_selected.testBit(row);
+    default:
+        return QVariant();
+    }
+}
+
+bool PkUpdatesModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (!index.isValid() || index.row() >= count() || role != SelectedRole)
+        return false;
+
+    const int row = tableRow(index.row());
+    const bool selected = value.toBool();
+    if (m_selected.testBit(row) != selected) {
+        m_selected.setBit(row, selected);
+        m_selectedCount += selected ? 1 : -1;
+        emit dataChanged(index, index, {SelectedRole});
+        emit selectionChanged();
+    }
+    return true;
+}
+
+Qt::ItemFlags PkUpdatesModel::flags(const QModelIndex &index) const
+{
+    return QAbstractListModel::flags(index) | Qt::ItemIsUserCheckable;
+}
+
+QHash<int, QByteArray> PkUpdatesModel::roleNames() const
+{
+    return {
+        {IdRole, "id"},
+        {NameRole, "name"},
+        {VersionRole, "version"},
+        {ArchRole, "arch"},
+        {RepoRole, "repo"},
+        {SummaryRole, "summary"},
+        {SeverityRole, "severity"},
+        {SelectedRole, "selected"}
+    };
+}
+
+int PkUpdatesModel::count() const
+{
+    return m_updates.count() - m_removedRows;
+}
+
+const PkUpdateTable &PkUpdatesModel::updates() const
+{
+    return m_updates;
+}
+
+quint64 PkUpdatesModel::generation() const
+{
+    return m_generation;
+}
+
+QVariantMap PkUpdatesModel::get(int row) const
+{
+    if (row < 0 || row >= count())
+        return QVariantMap();
+
+    row = tableRow(row);
+    return {
+        {QStringLiteral("id"), m_updates.packageId(row)},
+        {QStringLiteral("name"), m_updates.name(row)},
+        {QStringLiteral("version"), m_updates.version(row)},
+        {QStringLiteral("arch"), m_updates.arch(row)},
+        {QStringLiteral("repo"), m_updates.data(row)},
+        {QStringLiteral("summary"), m_updates.summary(row)},
+        {QStringLiteral("severity"), m_updates.severity(row)},
+        {QStringLiteral("selected"), m_selected.testBit(row)}
+    };
+}
+
+void PkUpdatesModel::setUpdates(const PkUpdateTable &updates)
+{
+    endMerge(false);
+    const int oldCount = m_updates.count();
+    bool changed = false;
+
+    QHash<QString, int> newRows;
+    newRows.reserve(updates.count());
+    for (int row = updates.count() - 1; row >= 0; --row)
+        newRows.insert(updates.packageKey(row), row);
+
+    // match the current rows with the new ones
+    QVector<int> oldToNew(m_updates.count(), -1);
+    QVector<bool> matched(updates.count(), false);
+    for (int row = 0; row < m_updates.count(); ++row) {
+        const int newRow = newRows.value(m_updates.packageKey(row), -1);
+        if (newRow != -1 && !matched.at(newRow)) {
+            oldToNew[row] = newRow;
+            matched[newRow] = true;
+        }
+    }
+
+    // drop the rows which are gone
+    QVector<bool> removed(oldToNew.count(), false);
+    int kept = 0;
+    for (int row = 0; row < oldToNew.count(); ++row) {
+        if (oldToNew.at(row) == -1)
+            removed[row] = true;
+        else
+            oldToNew[kept++] = oldToNew.at(row);
+    }
+    if (kept != oldToNew.count()) {
+        changed = true;
+        removeRows(removed);
+        oldToNew.resize(kept);
+    }
+
+    // update the rows which have changed in place
+    for (int row = 0; row < m_updates.count(); ++row) {
+        const int newRow = oldToNew.at(row);
+        if (m_updates.packageId(row) != updates.packageId(newRow) ||
+                m_updates.info(row) != updates.info(newRow) ||
+                m_updates.summary(row) != updates.summary(newRow)) {
+            changed = true;
+            m_updates.replace(row, updates.info(newRow), updates.packageId(newRow), updates.summary(newRow));
+            const QModelIndex idx = index(row);
+            emit dataChanged(idx, idx, {IdRole, VersionRole, RepoRole, SummaryRole, SeverityRole});
+        }
+    }
+
+    // append the new ones
+    const int added = matched.count(false);
+    if (added > 0) {
+        changed = true;
+        const int first = m_updates.count();
+        beginInsertRows(QModelIndex(), first, first + added - 1);
+        for (int newRow = 0; newRow < updates.count(); ++newRow) {
+            if (!matched.at(newRow)) {
+                m_updates.append(updates.info(newRow), updates.packageId(newRow), updates.summary(newRow));
+                appendSelection(true);
+            }
+        }
+        endInsertRows();
+    }
+
+    if (changed)
+        ++m_generation;
+    if (m_updates.count() != oldCount) {
+        emit countChanged();
+        emit selectionChanged();
+    }
+}
+
+void PkUpdatesModel::beginMerge()
+{
+    m_merging = true;
+    m_mergeRows.clear();
+    m_mergeRows.reserve(m_updates.count());
+    // the first row of a key wins, like in setUpdates()
+    for (int row = m_updates.count() - 1; row >= 0; --row)
+        m_mergeRows.insert(m_updates.packageKey(row), row);
+    m_mergeMatched.fill(false, m_updates.count());
+}
+
+void PkUpdatesModel::mergeUpdates(const PkUpdateTable &updates, int first)
+{
+    if (!m_merging)
+        beginMerge();
+
+    const int oldCount = m_updates.count();
+    bool changed = false;
+
+    // no rows get removed while merging, so the rows of m_mergeRows stay valid
+    QVector<int> added;
+    for (int newRow = first; newRow < updates.count(); ++newRow) {
+        const int row = m_mergeRows.value(updates.packageKey(newRow), -1);
+        if (row == -1 || m_mergeMatched.at(row)) {
+            added << newRow;
+            continue;
+        }
+
+        m_mergeMatched[row] = true;
+        if (m_updates.packageId(row) != updates.packageId(newRow) ||
+                m_updates.info(row) != updates.info(newRow) ||
+                m_updates.summary(row) != updates.summary(newRow)) {
+            changed = true;
+            m_updates.replace(row, updates.info(newRow), updates.packageId(newRow), updates.summary(newRow));
+            const QModelIndex idx = index(row);
+            emit dataChanged(idx, idx, {IdRole, VersionRole, RepoRole, SummaryRole, SeverityRole});
+        }
+    }
+
+    if (!added.isEmpty()) {
+        changed = true;
+        beginInsertRows(QModelIndex(), oldCount, oldCount + added.count() - 1);
+        for (int newRow : added) {
+            m_updates.append(updates.info(newRow), updates.packageId(newRow), updates.summary(newRow));
+            appendSelection(true);
+            m_mergeMatched.append(true);
+        }
+        endInsertRows();
+    }
+
+    if (changed)
+        ++m_generation;
+    if (m_updates.count() != oldCount) {
+        emit countChanged();
+        emit selectionChanged();
+    }
+}
+
+void PkUpdatesModel::endMerge(bool removeUnmatched)
+{
+    if (!m_merging)
+        return;
+
+    const int oldCount = m_updates.count();
+    if (removeUnmatched) {
+        QVector<bool> removed(m_mergeMatched.count());
+        for (int row = 0; row < m_mergeMatched.count(); ++row)
+            removed[row] = !m_mergeMatched.at(row);
+        removeRows(removed);
+    }
+
+    m_merging = false;
+    m_mergeRows.clear();
+    m_mergeMatched.clear();
+
+    if (m_updates.count() != oldCount) {
+        ++m_generation;
+        emit countChanged();
+        emit selectionChanged();
+    }
+}
+
+bool PkUpdatesModel::isMerging() const
+{
+    return m_merging;
+}
+
+void PkUpdatesModel::clear()
+{
+    endMerge(false);
+    if (m_updates.isEmpty())
+        return;
+
+    beginResetModel();
+    m_updates.clear();
+    m_selected.clear();
+    m_selectedCount = 0;
+    ++m_generation;
+    endResetModel();
+    emit countChanged();
+    emit selectionChanged();
+}
+
+QStringList PkUpdatesModel::selectedPackages() const
+{
+    QStringList result;
+    result.reserve(m_selectedCount);
+    for (int row = 0; row < m_selected.size() && result.count() < m_selectedCount; ++row) {
+        if (m_selected.testBit(row))
+            result << m_updates.packageId(row);
+    }
+    return result;
+}
+
+int PkUpdatesModel::selectedCount() const
+{
+    return m_selectedCount;
+}
+
+bool PkUpdatesModel::anySelected() const
+{
+    return m_selectedCount > 0;
+}
+
+bool PkUpdatesModel::allSelected() const
+{
+    return m_selectedCount == count();
+}
+
+void PkUpdatesModel::setAllSelected(bool selected)
+{
+    if (m_updates.isEmpty())
+        return;
+
+    m_selected.fill(selected);
+    m_selectedCount = selected ? m_updates.count() : 0;
+    emit dataChanged(index(0), index(m_updates.count() - 1), {SelectedRole});
+    emit selectionChanged();
+}
+
+void PkUpdatesModel::appendSelection(bool selected)
+{
+    const int row = m_selected.size();
+    m_selected.resize(row + 1);
+    m_selected.setBit(row, selected);
+    if (selected)
+        ++m_selectedCount;
+}
+
+void PkUpdatesModel::removeRows(const QVector<bool> &removed)
+{
+    // the views get a removal per contiguous range, the table and the selection are compacted once they're all
+    // out, so that scattered removals don't shift the tail over and over; tableRow() maps the rows in between
+    int last = removed.count() - 1;
+    while (last >= 0) {
+        if (!removed.at(last)) {
+            --last;
+            continue;
+        }
+        int first = last;
+        while (first > 0 && removed.at(first - 1))
+            --first;
+
+        // the ranges after this one are out of the views already, but the rows before it are still in place
+        beginRemoveRows(QModelIndex(), first, last);
+        m_removedRanges.append(qMakePair(first, last - first + 1));
+        m_removedRows += last - first + 1;
+        endRemoveRows();
+
+        last = first - 1;
+    }
+    if (m_removedRanges.isEmpty())
+        return;
+
+    m_updates.removeRows(removed);
+    int kept = 0;
+    for (int row = 0; row < m_selected.size(); ++row) {
+        if (removed.value(row)) {
+            if (m_selected.testBit(row))
+                --m_selectedCount;
+        } else {
+            m_selected.setBit(kept++, m_selected.testBit(row));
+        }
+    }
+    m_selected.resize(kept);
+    m_removedRanges.clear();
+    m_removedRows = 0;
+}
+
+int PkUpdatesModel::tableRow(int row) const
+{
+    // skip the ranges still in the table, from the first one on
+    for (int i = m_removedRanges.count() - 1; i >= 0 && row >= m_removedRanges.at(i).first; --i)
+        row += m_removedRanges.at(i).second;
+    return row;
+}
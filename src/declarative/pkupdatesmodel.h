@@ -0,0 +1,185 @@
+/***************************************************************************
+ *   Copyright (C) 2026 agent <agent@local>                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; see the file COPYING. If not, write to       *
+ *   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,  *
+ *   Boston, MA 02110-1301, USA.                                           *
+ ***************************************************************************/
+
+
+#ifndef PLASMA_PK_UPDATES_MODEL_H
+#define PLASMA_PK_UPDATES_MODEL_H
+
+#include <QAbstractListModel>
+#include <QBitArray>
+#include <QHash>
+#include <QPair>
+#include <QVariantMap>
+#include <QVector>
+
+#include <PackageKit/Transaction>
+
+#include "pkupdatetable.h"
+
+/**
+ * @brief The PkUpdatesModel class
+ *
+ * List model of the available updates, updated by PkUpdates when the
+ * GetUpdates transaction finishes. The rows are stored in a
+ * PkUpdateTable and all the roles are computed in C++ so that QML views
+ * can bind to it directly.
+ */
+class PkUpdatesModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(int selectedCount READ selectedCount NOTIFY selectionChanged)
+    Q_PROPERTY(bool anySelected READ anySelected NOTIFY selectionChanged)
+    Q_PROPERTY(bool allSelected READ allSelected NOTIFY selectionChanged)
+
+public:
+    enum Roles {
+        IdRole = Qt::UserRole + 1,
+        NameRole,
+        VersionRole,
+        ArchRole,
+        RepoRole,
+        SummaryRole,
+        SeverityRole,
+        SelectedRole
+    };
+    Q_ENUM(Roles)
+
+    enum Severity {
+        NormalSeverity = PkUpdateTable::NormalSeverity,
+        ImportantSeverity = PkUpdateTable::ImportantSeverity,
+        SecuritySeverity = PkUpdateTable::SecuritySeverity
+    };
+    Q_ENUM(Severity)
+
+    explicit PkUpdatesModel(QObject *parent = nullptr);
+    ~PkUpdatesModel();
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) Q_DECL_OVERRIDE;
+    Qt::ItemFlags flags(const QModelIndex &index) const Q_DECL_OVERRIDE;
+    QHash<int, QByteArray> roleNames() const Q_DECL_OVERRIDE;
+
+    /**
+     * @return the number of updates in the model
+     */
+    int count() const;
+
+    /**
+     * @return the underlying update table
+     */
+    const PkUpdateTable &updates() const;
+
+    /**
+     * @return a counter incremented each time the set of updates changes
+     */
+    quint64 generation() const;
+
+    /**
+     * Replace the updates with the contents of @p updates, emitting only the row
+     * removals, insertions and changes needed to get there. Packages are matched
+     * by name and arch, so that a new version of a package keeps its row and
+     * selection state. New packages are appended, selected.
+     */
+    void setUpdates(const PkUpdateTable &updates);
+
+    /**
+     * Start replacing the updates piecewise, for publishing them while they're still arriving.
+     * Each mergeUpdates() call then adds or updates rows like setUpdates() does, and endMerge()
+     * removes the rows no chunk has matched. setUpdates() and clear() abandon the merge.
+     */
+    void beginMerge();
+
+    /**
+     * Merge rows @p first to the end of @p updates into the model
+     * @see beginMerge()
+     */
+    void mergeUpdates(const PkUpdateTable &updates, int first);
+
+    /**
+     * Finish the merge in progress
+     * @param removeUnmatched whether to remove the rows no chunk has matched, false keeps them
+     */
+    void endMerge(bool removeUnmatched = true);
+
+    /**
+     * @return whether a merge is in progress
+     */
+    bool isMerging() const;
+
+    /**
+     * Remove all the updates
+     */
+    void clear();
+
+    /**
+     * @return all the roles of @p row in a single map keyed by the role names, empty if out of range
+     */
+    Q_INVOKABLE QVariantMap get(int row) const;
+
+    /**
+     * @return the IDs of all the packages currently selected for update
+     */
+    Q_INVOKABLE QStringList selectedPackages() const;
+
+    /**
+     * @return the number of packages selected for update
+     */
+    int selectedCount() const;
+
+    /**
+     * @return whether at least one package is selected
+     */
+    bool anySelected() const;
+
+    /**
+     * @return whether all the packages are selected
+     */
+    bool allSelected() const;
+
+    /**
+     * (De)select all the packages
+     */
+    Q_INVOKABLE void setAllSelected(bool selected);
+
+signals:
+    void countChanged();
+    void selectionChanged();
+
+private:
+    void appendSelection(bool selected);
+    void removeRows(const QVector<bool> &removed);
+    int tableRow(int row) const;
+
+    PkUpdateTable m_updates;
+    // one bit per row, and the number of bits set
+    QBitArray m_selected;
+    int m_selectedCount = 0;
+    quint64 m_generation = 0;
+    // ranges (first row, count) already removed from the views but still in the table, last one first
+    QVector<QPair<int, int>> m_removedRanges;
+    int m_removedRows = 0;
+    // rows by package key and whether a chunk has matched them, while merging
+    QHash<QString, int> m_mergeRows;
+    QVector<bool> m_mergeMatched;
+    bool m_merging = false;
+};
+
+#endif // PLASMA_PK_UPDATES_MODEL_H
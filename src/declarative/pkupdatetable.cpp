@@ -0,0 +1,380 @@
+/***************************************************************************
+ *   Copyright (C) 2026 agent <agent@local>                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; see the file COPYING. If not, write to       *
+ *   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,  *
+ *   Boston, MA 02110-1301, USA.                                           *
+ ***************************************************************************/
+
+#include <limits>
+
+#include "pkupdatetable.h"
+
+namespace
+{
+    quint16 clampLength(int length)
+    {
+        return static_cast<quint16>(qMin(length, int(std::numeric_limits<quint16>::max())));
+    }
+} // namespace {
+
+PkUpdateTable::PkUpdateTable()
+{
+    clear();
+}
+
+int PkUpdateTable::count() const
+{
+    return m_offsets.count();
+}
+
+bool PkUpdateTable::isEmpty() const
+{
+    return m_offsets.isEmpty();
+}
+
+int PkUpdateTable::append(PackageKit::Transaction::Info info, const QString &packageID, const QString &summary)
+{
+    const Fields fields = parsePackageId(packageID);
+    const Severity sev = severityForInfo(info);
+
+    m_offsets.append(m_strings.length());
+    m_idLengths.append(fields.idLength);
+    m_nameLengths.append(fields.nameLength);
+    m_versionLengths.append(fields.versionLength);
+    m_archLengths.append(fields.archLength);
+    m_summaryLengths.append(summary.length());
+    m_infos.append(static_cast<quint8>(info));
+    m_severities.append(static_cast<quint8>(sev));
+    m_strings.append(packageID.constData(), fields.idLength);
+    m_strings.append(summary);
+
+    ++m_severityCounts[sev];
+    m_severityRowsDirty = true;
+
+    return m_offsets.count() - 1;
+}
+
+void PkUpdateTable::replace(int row, PackageKit::Transaction::Info info, const QString &packageID, const QString &summary)
+{
+    const Fields fields = parsePackageId(packageID);
+    const Severity sev = severityForInfo(info);
+
+    m_garbage += storedLength(row);
+    --m_severityCounts[m_severities.at(row)];
+
+    m_offsets[row] = m_strings.length();
+    m_idLengths[row] = fields.idLength;
+    m_nameLengths[row] = fields.nameLength;
+    m_versionLengths[row] = fields.versionLength;
+    m_archLengths[row] = fields.archLength;
+    m_summaryLengths[row] = summary.length();
+    m_infos[row] = static_cast<quint8>(info);
+    m_severities[row] = static_cast<quint8>(sev);
+    m_strings.append(packageID.constData(), fields.idLength);
+    m_strings.append(summary);
+
+    ++m_severityCounts[sev];
+    m_severityRowsDirty = true;
+
+    if (m_garbage > m_strings.length() / 2)
+        compact();
+}
+
+void PkUpdateTable::remove(int row, int count)
+{
+    for (int i = row; i < row + count; ++i) {
+        m_garbage += storedLength(i);
+        --m_severityCounts[m_severities.at(i)];
+    }
+
+    m_offsets.remove(row, count);
+    m_idLengths.remove(row, count);
+    m_nameLengths.remove(row, count);
+    m_versionLengths.remove(row, count);
+    m_archLengths.remove(row, count);
+    m_summaryLengths.remove(row, count);
+    m_infos.remove(row, count);
+    m_severities.remove(row, count);
+    m_severityRowsDirty = true;
+
+    if (m_offsets.isEmpty())
+        clear();
+    else if (m_garbage > m_strings.length() / 2)
+        compact();
+}
+
+void PkUpdateTable::removeRows(const QVector<bool> &removed)
+{
+    int kept = 0;
+    for (int row = 0; row < m_offsets.count(); ++row) {
+        if (removed.value(row)) {
+            m_garbage += storedLength(row);
+            --m_severityCounts[m_severities.at(row)];
+            continue;
+        }
+        if (kept != row) {
+            m_offsets[kept] = m_offsets.at(row);
+            m_idLengths[kept] = m_idLengths.at(row);
+            m_nameLengths[kept] = m_nameLengths.at(row);
+            m_versionLengths[kept] = m_versionLengths.at(row);
+            m_archLengths[kept] = m_archLengths.at(row);
+            m_summaryLengths[kept] = m_summaryLengths.at(row);
+            m_infos[kept] = m_infos.at(row);
+            m_severities[kept] = m_severities.at(row);
+        }
+        ++kept;
+    }
+    if (kept == m_offsets.count())
+        return;
+
+    m_offsets.resize(kept);
+    m_idLengths.resize(kept);
+    m_nameLengths.resize(kept);
+    m_versionLengths.resize(kept);
+    m_archLengths.resize(kept);
+    m_summaryLengths.resize(kept);
+    m_infos.resize(kept);
+    m_severities.resize(kept);
+    m_severityRowsDirty = true;
+
+    if (m_offsets.isEmpty())
+        clear();
+    else if (m_garbage > m_strings.length() / 2)
+        compact();
+}
+
+void PkUpdateTable::clear()
+{
+    m_strings.clear();
+    m_offsets.clear();
+    m_idLengths.clear();
+    m_nameLengths.clear();
+    m_versionLengths.clear();
+    m_archLengths.clear();
+    m_summaryLengths.clear();
+    m_infos.clear();
+    m_severities.clear();
+    for (int i = 0; i < SeverityCount; ++i) {
+        m_severityCounts[i] = 0;
+        m_severityRows[i].clear();
+    }
+    m_severityRowsDirty = false;
+    m_garbage = 0;
+}
+
+QString PkUpdateTable::packageId(int row) const
+{
+    return field(row, 0, m_idLengths.at(row));
+}
+
+QStringList PkUpdateTable::packageIds() const
+{
+    QStringList result;
+    result.reserve(count());
+    for (int row = 0; row < count(); ++row)
+        result << packageId(row);
+    return result;
+}
+
+QString PkUpdateTable::name(int row) const
+{
+    return field(row, 0, m_nameLengths.at(row));
+}
+
+QString PkUpdateTable::version(int row) const
+{
+    return field(row, m_nameLengths.at(row) + 1, m_versionLengths.at(row));
+}
+
+QString PkUpdateTable::arch(int row) const
+{
+    return field(row, m_nameLengths.at(row) + m_versionLengths.at(row) + 2, m_archLengths.at(row));
+}
+
+QString PkUpdateTable::data(int row) const
+{
+    const int start = m_nameLengths.at(row) + m_versionLengths.at(row) + m_archLengths.at(row) + 3;
+    return field(row, start, m_idLengths.at(row) - start);
+}
+
+QString PkUpdateTable::summary(int row) const
+{
+    return QString(m_strings.constData() + m_offsets.at(row) + m_idLengths.at(row), m_summaryLengths.at(row));
+}
+
+PackageKit::Transaction::Info PkUpdateTable::info(int row) const
+{
+    return static_cast<PackageKit::Transaction::Info>(m_infos.at(row));
+}
+
+PkUpdateTable::Severity PkUpdateTable::severity(int row) const
+{
+    return static_cast<Severity>(m_severities.at(row));
+}
+
+QString PkUpdateTable::packageKey(int row) const
+{
+    return name(row) + QLatin1Char(';') + arch(row);
+}
+
+int PkUpdateTable::severityCount(Severity severity) const
+{
+    return m_severityCounts[severity];
+}
+
+QVector<int> PkUpdateTable::rowsOfSeverity(Severity severity) const
+{
+    if (m_severityRowsDirty)
+        rebuildSeverityRows();
+
+    return m_severityRows[severity];
+}
+
+PkUpdateTable::Severity PkUpdateTable::severityForInfo(PackageKit::Transaction::Info info)
+{
+    switch (info) {
+    case PackageKit::Transaction::InfoSecurity:
+        return SecuritySeverity;
+    case PackageKit::Transaction::InfoImportant:
+        return ImportantSeverity;
+    default:
+        return NormalSeverity;
+    }
+}
+
+PkUpdateTable::Fields PkUpdateTable::parsePackageId(const QString &packageID)
+{
+    // package ID format is "name;version;arch;data"
+    const int nameEnd = packageID.indexOf(QLatin1Char(';'));
+    const int versionEnd = nameEnd == -1 ? -1 : packageID.indexOf(QLatin1Char(';'), nameEnd + 1);
+    const int archEnd = versionEnd == -1 ? -1 : packageID.indexOf(QLatin1Char(';'), versionEnd + 1);
+
+    const int idLength = clampLength(packageID.length());
+    const int nameLength = nameEnd == -1 ? idLength : nameEnd;
+    const int versionLength = nameEnd == -1 ? 0 : (versionEnd == -1 ? idLength : versionEnd) - nameEnd - 1;
+    const int archLength = versionEnd == -1 ? 0 : (archEnd == -1 ? idLength : archEnd) - versionEnd - 1;
+
+    return {clampLength(idLength), clampLength(nameLength), clampLength(versionLength), clampLength(archLength)};
+}
+
+QString PkUpdateTable::field(int row, int start, int length) const
+{
+    if (length <= 0)
+        return QString();
+
+    return QString(m_strings.constData() + m_offsets.at(row) + start, length);
+}
+
+int PkUpdateTable::storedLength(int row) const
+{
+    return m_idLengths.at(row) + m_summaryLengths.at(row);
+}
+
+void PkUpdateTable::compact()
+{
+    QString strings;
+    strings.reserve(m_strings.length() - m_garbage);
+    for (int row = 0; row < m_offsets.count(); ++row) {
+        const int offset = m_offsets.at(row);
+        m_offsets[row] = strings.length();
+        strings.append(m_strings.constData() + offset, storedLength(row));
+    }
+    m_strings = strings;
+    m_garbage = 0;
+}
+
+bool PkUpdateTable::isValid() const
+{
+    const int rows = m_offsets.count();
+    if (m_idLengths.count() != rows || m_nameLengths.count() != rows || m_versionLengths.count() != rows ||
+            m_archLengths.count() != rows || m_summaryLengths.count() != rows || m_infos.count() != rows ||
+            m_severities.count() != rows) {
+        return false;
+    }
+
+    for (int row = 0; row < rows; ++row) {
+        // every field has to end within the package ID; a field missing from the ID is stored with a length
+        // of 0, and the data field takes whatever is left after the separators
+        const int idLength = m_idLengths.at(row);
+        const int nameEnd = m_nameLengths.at(row);
+        const int versionEnd = nameEnd + 1 + m_versionLengths.at(row);
+        const int archEnd = versionEnd + 1 + m_archLengths.at(row);
+        if (m_severities.at(row) >= SeverityCount ||
+                nameEnd > idLength ||
+                (m_versionLengths.at(row) > 0 && versionEnd > idLength) ||
+                (m_archLengths.at(row) > 0 && archEnd > idLength) ||
+                qint64(m_offsets.at(row)) + storedLength(row) > m_strings.length()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void PkUpdateTable::rebuildSeverityRows() const
+{
+    for (int i = 0; i < SeverityCount; ++i) {
+        m_severityRows[i].clear();
+        m_severityRows[i].reserve(m_severityCounts[i]);
+    }
+    for (int row = 0; row < m_severities.count(); ++row)
+        m_severityRows[m_severities.at(row)].append(row);
+
+    m_severityRowsDirty = false;
+}
+
+QDataStream &operator<<(QDataStream &stream, const PkUpdateTable &table)
+{
+    // don't write out the garbage left by removed rows
+    PkUpdateTable compacted(table);
+    if (compacted.m_garbage > 0)
+        compacted.compact();
+
+    stream << compacted.m_strings
+           << compacted.m_offsets
+           << compacted.m_idLengths
+           << compacted.m_nameLengths
+           << compacted.m_versionLengths
+           << compacted.m_archLengths
+           << compacted.m_summaryLengths
+           << compacted.m_infos
+           << compacted.m_severities;
+    return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, PkUpdateTable &table)
+{
+    table.clear();
+    stream >> table.m_strings
+           >> table.m_offsets
+           >> table.m_idLengths
+           >> table.m_nameLengths
+           >> table.m_versionLengths
+           >> table.m_archLengths
+           >> table.m_summaryLengths
+           >> table.m_infos
+           >> table.m_severities;
+
+    if (stream.status() != QDataStream::Ok || !table.isValid()) {
+        table.clear();
+        stream.setStatus(QDataStream::ReadCorruptData);
+        return stream;
+    }
+
+    for (int row = 0; row < table.count(); ++row)
+        ++table.m_severityCounts[table.m_severities.at(row)];
+    table.m_severityRowsDirty = true;
+
+    return stream;
+}
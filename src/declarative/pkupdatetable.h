@@ -0,0 +1,165 @@
+/***************************************************************************
+ *   Copyright (C) 2026 agent <agent@local>                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; see the file COPYING. If not, write to       *
+ *   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,  *
+ *   Boston, MA 02110-1301, USA.                                           *
+ ***************************************************************************/
+
+
+#ifndef PLASMA_PK_UPDATE_TABLE_H
+#define PLASMA_PK_UPDATE_TABLE_H
+
+#include <QDataStream>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <PackageKit/Transaction>
+
+/**
+ * @brief The PkUpdateTable class
+ *
+ * Compact storage of the available updates. The package IDs and summaries
+ * of all the rows are kept in a single string buffer, with the fields of
+ * the package ID ("name;version;arch;data") stored as offsets into it.
+ * Each row keeps its PackageKit info and severity as single bytes, and the
+ * number of rows per severity is maintained so that counting is O(1).
+ */
+class PkUpdateTable
+{
+public:
+    enum Severity {NormalSeverity, ImportantSeverity, SecuritySeverity, SeverityCount};
+
+    PkUpdateTable();
+
+    /**
+     * @return the number of rows
+     */
+    int count() const;
+
+    /**
+     * @return whether the table has no rows
+     */
+    bool isEmpty() const;
+
+    /**
+     * Append an update package, returning its row
+     */
+    int append(PackageKit::Transaction::Info info, const QString &packageID, const QString &summary);
+
+    /**
+     * Replace the contents of @p row with another update package
+     */
+    void replace(int row, PackageKit::Transaction::Info info, const QString &packageID, const QString &summary);
+
+    /**
+     * Remove @p count rows starting at @p row
+     */
+    void remove(int row, int count = 1);
+
+    /**
+     * Remove the rows for which @p removed is true, in a single pass
+     */
+    void removeRows(const QVector<bool> &removed);
+
+    /**
+     * Remove all the rows
+     */
+    void clear();
+
+    QString packageId(int row) const;
+
+    /**
+     * @return the package IDs of all the rows
+     */
+    QStringList packageIds() const;
+
+    QString name(int row) const;
+    QString version(int row) const;
+    QString arch(int row) const;
+    QString data(int row) const;
+    QString summary(int row) const;
+    PackageKit::Transaction::Info info(int row) const;
+    Severity severity(int row) const;
+
+    /**
+     * @return the key identifying the package of @p row across versions ("name;arch")
+     */
+    QString packageKey(int row) const;
+
+    /**
+     * @return the number of rows with the given @p severity
+     */
+    int severityCount(Severity severity) const;
+
+    /**
+     * @return the rows with the given @p severity, in ascending order
+     */
+    QVector<int> rowsOfSeverity(Severity severity) const;
+
+    /**
+     * @return the severity matching the PackageKit update @p info
+     */
+    static Severity severityForInfo(PackageKit::Transaction::Info info);
+
+private:
+    friend QDataStream &operator<<(QDataStream &stream, const PkUpdateTable &table);
+    friend QDataStream &operator>>(QDataStream &stream, PkUpdateTable &table);
+
+    struct Fields {
+        quint16 idLength;
+        quint16 nameLength;
+        quint16 versionLength;
+        quint16 archLength;
+    };
+
+    static Fields parsePackageId(const QString &packageID);
+    QString field(int row, int start, int length) const;
+    int storedLength(int row) const;
+    void compact();
+    bool isValid() const;
+    void rebuildSeverityRows() const;
+
+    // IDs and summaries of all the rows, back to back
+    QString m_strings;
+    // start of the package ID of each row in m_strings, the summary follows it
+    QVector<quint32> m_offsets;
+    QVector<quint16> m_idLengths;
+    QVector<quint16> m_nameLengths;
+    QVector<quint16> m_versionLengths;
+    QVector<quint16> m_archLengths;
+    QVector<quint32> m_summaryLengths;
+    QVector<quint8> m_infos;
+    QVector<quint8> m_severities;
+    int m_severityCounts[SeverityCount];
+    // number of characters in m_strings no longer referenced by any row
+    int m_garbage = 0;
+    // built lazily on request
+    mutable QVector<int> m_severityRows[SeverityCount];
+    mutable bool m_severityRowsDirty = false;
+};
+
+/**
+ * Serialize the table in a compact binary form, used for the on-disk cache
+ */
+QDataStream &operator<<(QDataStream &stream, const PkUpdateTable &table);
+
+/**
+ * Deserialize a table written by operator<<(); the table is left empty and the
+ * stream status set to QDataStream::ReadCorruptData if the data is not consistent
+ */
+QDataStream &operator>>(QDataStream &stream, PkUpdateTable &table);
+
+#endif // PLASMA_PK_UPDATE_TABLE_H
@@ -22,11 +22,15 @@
 
 #include "qmlplugins.h"
 #include "pkupdates.h"
+#include "pkupdatesmodel.h"
+#include "pkupdatesfiltermodel.h"
 
 void QmlPlugins::registerTypes(const char* uri)
 {
     Q_ASSERT(uri == QLatin1String("org.kde.plasma.PackageKit"));
 
     // @uri org.kde.plasma.PackageKit.PkUpdates
+    qmlRegisterUncreatableType<PkUpdatesModel>(uri, 1, 0, "PkUpdatesModel", QStringLiteral("Use PkUpdates.updatesModel"));
+    qmlRegisterType<PkUpdatesFilterModel>(uri, 1, 0, "PkUpdatesFilterModel");
     qmlRegisterSingletonType<PkUpdates>(uri, 1, 0, "PkUpdates", [](QQmlEngine*, QJSEngine*) -> QObject* { return new PkUpdates; });
 }
@@ -0,0 +1,64 @@
+/***************************************************************************
+ *   Copyright (C) 2026 agent <agent@local>                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; see the file COPYING. If not, write to       *
+ *   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,  *
+ *   Boston, MA 02110-1301, USA.                                           *
+ ***************************************************************************/
+
+#include "transactionfactory.h"
+
+TransactionFactory::TransactionFactory(QObject *parent) :
+    QObject(parent)
+{
+}
+
+TransactionFactory::~TransactionFactory()
+{
+}
+
+PackageKit::Transaction * TransactionFactory::refreshCache(bool force)
+{
+    return PackageKit::Daemon::refreshCache(force);
+}
+
+PackageKit::Transaction * TransactionFactory::getUpdates()
+{
+    return PackageKit::Daemon::getUpdates();
+}
+
+PackageKit::Transaction * TransactionFactory::getUpdatesDetails(const QStringList &packageIDs)
+{
+    return PackageKit::Daemon::getUpdatesDetails(packageIDs);
+}
+
+PackageKit::Transaction * TransactionFactory::updatePackages(const QStringList &packageIDs, PackageKit::Transaction::TransactionFlags flags)
+{
+    return PackageKit::Daemon::updatePackages(packageIDs, flags);
+}
+
+PackageKit::Transaction * TransactionFactory::acceptEula(const QString &eulaID)
+{
+    return PackageKit::Daemon::acceptEula(eulaID);
+}
+
+PackageKit::Daemon::Network TransactionFactory::networkState() const
+{
+    return PackageKit::Daemon::networkState();
+}
+
+bool TransactionFactory::isDaemon() const
+{
+    return true;
+}
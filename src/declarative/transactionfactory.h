@@ -0,0 +1,64 @@
+/***************************************************************************
+ *   Copyright (C) 2026 agent <agent@local>                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; see the file COPYING. If not, write to       *
+ *   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,  *
+ *   Boston, MA 02110-1301, USA.                                           *
+ ***************************************************************************/
+
+#ifndef PLASMA_PK_TRANSACTION_FACTORY_H
+#define PLASMA_PK_TRANSACTION_FACTORY_H
+
+#include <QObject>
+#include <QStringList>
+
+#include <PackageKit/Daemon>
+#include <PackageKit/Transaction>
+
+/**
+ * @brief The TransactionFactory class
+ *
+ * Starts the transactions of PkUpdates and tells it the state of the network
+ * they run in. This one asks the PackageKit daemon; FakeTransactionSource
+ * overrides it to run PkUpdates against replayed transactions, through the
+ * same handlers and with the same ownership of the transactions.
+ *
+ * The transactions are PackageKit::Transaction objects either way, which
+ * set up a proxy on the system bus when created. A factory that isn't the
+ * daemon keeps PkUpdates from following the daemon, but only a disabled
+ * system bus keeps its transactions from reaching one.
+ */
+class TransactionFactory : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TransactionFactory(QObject *parent = nullptr);
+    ~TransactionFactory();
+
+    virtual PackageKit::Transaction * refreshCache(bool force);
+    virtual PackageKit::Transaction * getUpdates();
+    virtual PackageKit::Transaction * getUpdatesDetails(const QStringList &packageIDs);
+    virtual PackageKit::Transaction * updatePackages(const QStringList &packageIDs, PackageKit::Transaction::TransactionFlags flags);
+    virtual PackageKit::Transaction * acceptEula(const QString &eulaID);
+    virtual PackageKit::Daemon::Network networkState() const;
+
+    /**
+     * @return true if the transactions started are the daemon's, whose changes,
+     * offline updates and power management PkUpdates then follows
+     */
+    virtual bool isDaemon() const;
+};
+
+#endif // PLASMA_PK_TRANSACTION_FACTORY_H
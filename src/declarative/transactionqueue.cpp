@@ -0,0 +1,141 @@
+/***************************************************************************
+ *   Copyright (C) 2026 agent <agent@local>                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; see the file COPYING. If not, write to       *
+ *   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,  *
+ *   Boston, MA 02110-1301, USA.                                           *
+ ***************************************************************************/
+
+#include "transactionqueue.h"
+#include "pkupdates.h"
+
+TransactionQueue::TransactionQueue(QObject *parent) :
+    QObject(parent)
+{
+}
+
+TransactionQueue::~TransactionQueue()
+{
+}
+
+void TransactionQueue::enqueue(Priority priority, const QString &tag, const Starter &starter, bool preemptible)
+{
+    Lane &lane = m_lanes[laneFor(priority)];
+    bool replaced = false;
+    if (!tag.isEmpty()) {
+        for (int i = 0; i < lane.waiting.count(); ++i) {
+            if (lane.waiting.at(i).tag == tag) {
+                qCDebug(PLASMA_PK_UPDATES) << "Replacing the waiting job" << tag;
+                lane.waiting.removeAt(i);
+                replaced = true;
+                break;
+            }
+        }
+    }
+
+    // behind all the jobs of the same or a higher priority
+    int pos = 0;
+    while (pos < lane.waiting.count() && lane.waiting.at(pos).priority >= priority)
+        ++pos;
+    lane.waiting.insert(pos, Job{priority, tag, starter, preemptible});
+    if (!replaced)
+        emit depthChanged();
+
+    if (lane.busy && lane.running && lane.runningPreemptible && !lane.runningPreempted && lane.runningPriority < priority
+            && lane.running->allowCancel()) {
+        qCDebug(PLASMA_PK_UPDATES) << "Cancelling" << lane.runningTag << "in favor of" << tag;
+        lane.runningPreempted = true;
+        lane.running->cancel();
+    }
+
+    startNext(lane);
+}
+
+bool TransactionQueue::isWaiting(const QString &tag) const
+{
+    for (const Lane &lane : m_lanes) {
+        for (const Job &job : lane.waiting) {
+            if (job.tag == tag)
+                return true;
+        }
+    }
+    return false;
+}
+
+int TransactionQueue::depth() const
+{
+    int depth = 0;
+    for (const Lane &lane : m_lanes)
+        depth += lane.waiting.count() + (lane.busy ? 1 : 0);
+    return depth;
+}
+
+bool TransactionQueue::isPreempted(const PackageKit::Transaction *trans) const
+{
+    for (const Lane &lane : m_lanes) {
+        if (lane.busy && lane.runningObject == trans)
+            return lane.runningPreempted;
+    }
+    return false;
+}
+
+void TransactionQueue::onFinished()
+{
+    for (Lane &lane : m_lanes) {
+        // ignore the destruction of a transaction that has finished already
+        if (!lane.busy || lane.runningObject != sender())
+            continue;
+
+        lane.busy = false;
+        lane.running = nullptr;
+        lane.runningObject = nullptr;
+        lane.runningPreempted = false;
+        lane.runningTag.clear();
+        emit depthChanged();
+
+        startNext(lane);
+        return;
+    }
+}
+
+TransactionQueue::LaneId TransactionQueue::laneFor(Priority priority)
+{
+    return priority == Detail ? DetailLane : MainLane;
+}
+
+void TransactionQueue::startNext(Lane &lane)
+{
+    while (!lane.busy && !lane.waiting.isEmpty()) {
+        const Job job = lane.waiting.takeFirst();
+        // jobs queued by the starter itself have to wait
+        lane.busy = true;
+        PackageKit::Transaction * trans = job.starter();
+        if (!trans) {
+            lane.busy = false;
+            emit depthChanged();
+            continue;
+        }
+
+        qCDebug(PLASMA_PK_UPDATES) << "Started" << job.tag << "with priority" << job.priority << "," << lane.waiting.count() << "jobs waiting";
+        lane.running = trans;
+        lane.runningObject = trans;
+        lane.runningPriority = job.priority;
+        lane.runningPreemptible = job.preemptible;
+        lane.runningPreempted = false;
+        lane.runningTag = job.tag;
+        // connected after the backend, so its handlers see the transaction finish first
+        connect(trans, &PackageKit::Transaction::finished, this, &TransactionQueue::onFinished);
+        connect(trans, &QObject::destroyed, this, &TransactionQueue::onFinished);
+    }
+}
@@ -0,0 +1,126 @@
+/***************************************************************************
+ *   Copyright (C) 2026 agent <agent@local>                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; see the file COPYING. If not, write to       *
+ *   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,  *
+ *   Boston, MA 02110-1301, USA.                                           *
+ ***************************************************************************/
+
+#ifndef PLASMA_PK_TRANSACTION_QUEUE_H
+#define PLASMA_PK_TRANSACTION_QUEUE_H
+
+#include <functional>
+
+#include <QList>
+#include <QObject>
+#include <QPointer>
+
+#include <PackageKit/Transaction>
+
+/**
+ * @brief The TransactionQueue class
+ *
+ * Runs the transactions of the backend one at a time, ordered by priority,
+ * so that a background refresh doesn't end up contending with an installation
+ * in the daemon. Jobs of the same priority run in the order they were queued.
+ * A running job that was queued as preemptible gets cancelled as soon as a job
+ * of a higher priority arrives; everything else waits for the running
+ * transaction to finish. Detail lookups only read what the daemon knows
+ * already, so they run one at a time on a lane of their own instead of
+ * waiting for whatever else is running.
+ */
+class TransactionQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Priority {
+        Background = 0,  ///< automatic refresh, getting the updates otherwise, downloading ahead
+        Detail,          ///< update details
+        Check,           ///< user initiated check, getting the updates for it
+        Install          ///< installing updates, accepting EULAs
+    };
+
+    /**
+     * Starts the transaction of a job, returns nullptr if there's nothing to do (any more)
+     */
+    using Starter = std::function<PackageKit::Transaction *()>;
+
+    explicit TransactionQueue(QObject *parent = nullptr);
+    ~TransactionQueue();
+
+    /**
+     * Queue a job and start it right away if nothing else is running.
+     *
+     * @param priority the priority of the job
+     * @param tag identifies the job, a waiting job with the same tag gets replaced; empty for none
+     * @param starter starts the transaction once it's the job's turn
+     * @param preemptible whether the running job may be cancelled in favor of jobs of a higher priority
+     */
+    void enqueue(Priority priority, const QString &tag, const Starter &starter, bool preemptible = false);
+
+    /**
+     * @return whether a job tagged @p tag is waiting to be started
+     */
+    bool isWaiting(const QString &tag) const;
+
+    /**
+     * @return the number of waiting and running jobs
+     */
+    int depth() const;
+
+    /**
+     * @return whether @p trans is running and was cancelled in favor of a job of a higher priority
+     */
+    bool isPreempted(const PackageKit::Transaction *trans) const;
+
+signals:
+    void depthChanged();
+
+private slots:
+    void onFinished();
+
+private:
+    struct Job {
+        Priority priority;
+        QString tag;
+        Starter starter;
+        bool preemptible;
+    };
+
+    enum LaneId {
+        MainLane,
+        DetailLane,
+        LaneCount
+    };
+
+    struct Lane {
+        QList<Job> waiting;
+        QPointer<PackageKit::Transaction> running;
+        // identifies the running transaction while it's being destroyed, when the QPointer is null already
+        const QObject * runningObject = nullptr;
+        bool busy = false;
+        Priority runningPriority = Background;
+        bool runningPreemptible = false;
+        bool runningPreempted = false;
+        QString runningTag;
+    };
+
+    static LaneId laneFor(Priority priority);
+    void startNext(Lane &lane);
+
+    Lane m_lanes[LaneCount];
+};
+
+#endif // PLASMA_PK_TRANSACTION_QUEUE_H
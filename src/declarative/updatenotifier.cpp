@@ -0,0 +1,206 @@
+/***************************************************************************
+ *   Copyright (C) 2026 agent <agent@local>                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; see the file COPYING. If not, write to       *
+ *   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,  *
+ *   Boston, MA 02110-1301, USA.                                           *
+ ***************************************************************************/
+
+#include <QDateTime>
+#include <QTimer>
+
+#include <KLocalizedString>
+
+#include <PackageKit/Daemon>
+
+#include "updatenotifier.h"
+#include "pkupdates.h"
+
+namespace
+{
+    const auto s_pkUpdatesIconName = QStringLiteral("system-software-update");
+    const auto s_componentName = QStringLiteral("plasma_pk_updates");
+    const auto s_eventIdUpdatesAvailable = QStringLiteral("updatesAvailable");
+    const auto s_eventIdUpdatesInstalled = QStringLiteral("updatesInstalled");
+    const auto s_eventIdRestartRequired = QStringLiteral("restartRequired");
+    const auto s_eventIdError = QStringLiteral("updateError");
+    // PackageKit sends the restart requests of a transaction in a burst, one per package
+    const int s_restartDelay = 1000; // ms
+    // a fresh error notification gets its text replaced instead of another one popping up
+    const qint64 s_errorInterval = 60 * 1000; // ms
+    // the same error isn't shown again for this long
+    const qint64 s_errorRepeatInterval = 30 * 60 * 1000; // ms
+} // namespace {
+
+UpdateNotifier::UpdateNotifier(QObject *parent) :
+    QObject(parent),
+    m_restartTimer(new QTimer(this))
+{
+    m_restartTimer->setSingleShot(true);
+    m_restartTimer->setInterval(s_restartDelay);
+    connect(m_restartTimer, &QTimer::timeout, this, &UpdateNotifier::showRestart);
+}
+
+UpdateNotifier::~UpdateNotifier()
+{
+}
+
+void UpdateNotifier::updatesAvailable(int count)
+{
+    if (count <= 0) {
+        if (m_updatesNotification) {
+            qCDebug(PLASMA_PK_UPDATES) << "Disposing old update count notification";
+            m_updatesNotification->close();
+        }
+        m_updateCount = 0;
+        return;
+    }
+
+    if (count == m_updateCount)
+        return;
+
+    m_updateCount = count;
+    const QString text = i18np("You have 1 new update", "You have %1 new updates", count);
+    if (m_updatesNotification) {
+        qCDebug(PLASMA_PK_UPDATES) << "Updating the update count notification";
+        m_updatesNotification->setText(text);
+        m_updatesNotification->update();
+        return;
+    }
+
+    m_updatesNotification = createNotification(s_eventIdUpdatesAvailable, KNotification::Persistent, QString(), text);
+    connect(m_updatesNotification.data(), &KNotification::closed, this, [this] {
+        qCDebug(PLASMA_PK_UPDATES) << "Old notification closed";
+        // show it again after the next check
+        m_updateCount = 0;
+    });
+    m_updatesNotification->sendEvent();
+}
+
+void UpdateNotifier::updatesInstalled(int count)
+{
+    if (m_updatesNotification)
+        m_updatesNotification->close();
+
+    createNotification(s_eventIdUpdatesInstalled, KNotification::CloseOnTimeout, i18n("Updates Installed"),
+                       i18np("Successfully updated %1 package", "Successfully updated %1 packages", count))->sendEvent();
+}
+
+void UpdateNotifier::restartRequired(PackageKit::Transaction::Restart type, const QString &packageID)
+{
+    if (type != PackageKit::Transaction::RestartSystem && type != PackageKit::Transaction::RestartSession)
+        return;
+
+    qCDebug(PLASMA_PK_UPDATES) << "Restart requested by" << packageID;
+    ++m_restartRequests;
+    // a system restart implies a new session
+    if (m_restartType != PackageKit::Transaction::RestartSystem)
+        m_restartType = type;
+    if (!m_restartTimer->isActive())
+        m_restartTimer->start();
+}
+
+void UpdateNotifier::showRestart()
+{
+    qCDebug(PLASMA_PK_UPDATES) << "Coalesced" << m_restartRequests << "restart requests into a"
+                               << PackageKit::Daemon::enumToString<PackageKit::Transaction>((int)m_restartType, "Restart");
+    const PackageKit::Transaction::Restart type = m_restartType;
+    m_restartType = PackageKit::Transaction::RestartNone;
+    m_restartRequests = 0;
+
+    // still being shown, and for a restart at least as big
+    if (m_restartNotification && (type == m_shownRestartType || m_shownRestartType == PackageKit::Transaction::RestartSystem))
+        return;
+
+    if (type == PackageKit::Transaction::RestartSystem) {
+        showRestartNotification(type, i18n("Restart is required"),
+                                i18n("The computer will have to be restarted after the update for the changes to take effect."));
+    } else {
+        showRestartNotification(type, i18n("Session restart is required"),
+                                i18n("You will need to log out and back in after the update for the changes to take effect."));
+    }
+}
+
+void UpdateNotifier::updatesPrepared(int count)
+{
+    if (m_updatesNotification)
+        m_updatesNotification->close();
+
+    showRestartNotification(PackageKit::Transaction::RestartSystem, i18n("Updates are ready"),
+                            i18np("1 update will be installed when the computer restarts.",
+                                  "%1 updates will be installed when the computer restarts.", count));
+}
+
+void UpdateNotifier::showRestartNotification(PackageKit::Transaction::Restart type, const QString &title, const QString &text)
+{
+    const QString action = type == PackageKit::Transaction::RestartSystem ? i18nc("@action:button", "Restart")
+                                                                          : i18nc("@action:button", "Logout");
+    m_shownRestartType = type;
+
+    if (m_restartNotification) {
+        m_restartNotification->setActions(QStringList{action});
+        m_restartNotification->setTitle(title);
+        m_restartNotification->setText(text);
+        m_restartNotification->update();
+        return;
+    }
+
+    m_restartNotification = createNotification(s_eventIdRestartRequired, KNotification::Persistent, title, text);
+    m_restartNotification->setActions(QStringList{action});
+    connect(m_restartNotification.data(), &KNotification::action1Activated, this, [this] () {
+        emit restartActivated(m_shownRestartType);
+    });
+    m_restartNotification->sendEvent();
+}
+
+void UpdateNotifier::error(const QString &details)
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (auto it = m_recentErrors.begin(); it != m_recentErrors.end();) {
+        if (now - it.value() >= s_errorRepeatInterval)
+            it = m_recentErrors.erase(it);
+        else
+            ++it;
+    }
+
+    if (m_recentErrors.contains(details)) {
+        qCDebug(PLASMA_PK_UPDATES) << "Not showing the same error again";
+        return;
+    }
+    m_recentErrors.insert(details, now);
+
+    if (m_errorNotification && now - m_errorShown < s_errorInterval) {
+        qCDebug(PLASMA_PK_UPDATES) << "Replacing the text of the error notification";
+        m_errorNotification->setText(details);
+        m_errorNotification->update();
+        return;
+    }
+
+    if (m_errorNotification)
+        m_errorNotification->close();
+    m_errorShown = now;
+    m_errorNotification = createNotification(s_eventIdError, KNotification::Persistent, i18n("Update Error"), details);
+    m_errorNotification->sendEvent();
+}
+
+KNotification * UpdateNotifier::createNotification(const QString &eventId, KNotification::NotificationFlags flags,
+                                                   const QString &title, const QString &text)
+{
+    KNotification * notification = new KNotification(eventId, flags);
+    notification->setComponentName(s_componentName);
+    notification->setIconName(s_pkUpdatesIconName);
+    notification->setTitle(title);
+    notification->setText(text);
+    return notification;
+}
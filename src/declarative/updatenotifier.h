@@ -0,0 +1,104 @@
+/***************************************************************************
+ *   Copyright (C) 2026 agent <agent@local>                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; see the file COPYING. If not, write to       *
+ *   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,  *
+ *   Boston, MA 02110-1301, USA.                                           *
+ ***************************************************************************/
+
+#ifndef PLASMA_PK_UPDATE_NOTIFIER_H
+#define PLASMA_PK_UPDATE_NOTIFIER_H
+
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+
+#include <KNotification>
+
+#include <PackageKit/Transaction>
+
+class QTimer;
+
+/**
+ * @brief The UpdateNotifier class
+ *
+ * Owns all the notifications of the updater, keeping their number down.
+ * There's at most one notification about available updates, updated in
+ * place when the count changes. The restart requests PackageKit sends for
+ * each package of a transaction get coalesced into a single notification,
+ * and errors are rate-limited, repeated ones being dropped.
+ */
+class UpdateNotifier : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit UpdateNotifier(QObject *parent = nullptr);
+    ~UpdateNotifier();
+
+    /**
+     * Show the number of available updates, closing the notification if there are none
+     */
+    void updatesAvailable(int count);
+
+    /**
+     * Tell the user that @p count updates were installed successfully
+     */
+    void updatesInstalled(int count);
+
+    /**
+     * Ask the user to restart after the update, the requests of a transaction get collected into one
+     */
+    void restartRequired(PackageKit::Transaction::Restart type, const QString &packageID);
+
+    /**
+     * Tell the user that @p count updates will be installed on the next restart, offering to restart now
+     */
+    void updatesPrepared(int count);
+
+    /**
+     * Show an error, unless the same one was shown lately or another one is still fresh, which then gets replaced
+     */
+    void error(const QString &details);
+
+signals:
+    /**
+     * Emitted when the user asked to restart from a notification
+     */
+    void restartActivated(PackageKit::Transaction::Restart type);
+
+private slots:
+    void showRestart();
+
+private:
+    void showRestartNotification(PackageKit::Transaction::Restart type, const QString &title, const QString &text);
+    KNotification * createNotification(const QString &eventId, KNotification::NotificationFlags flags,
+                                       const QString &title, const QString &text);
+
+    QPointer<KNotification> m_updatesNotification;
+    int m_updateCount = 0;
+
+    QTimer * m_restartTimer;
+    QPointer<KNotification> m_restartNotification;
+    PackageKit::Transaction::Restart m_restartType = PackageKit::Transaction::RestartNone;
+    PackageKit::Transaction::Restart m_shownRestartType = PackageKit::Transaction::RestartNone;
+    int m_restartRequests = 0;
+
+    QPointer<KNotification> m_errorNotification;
+    qint64 m_errorShown = -1;
+    // when each error was last reported, by its details
+    QHash<QString, qint64> m_recentErrors;
+};
+
+#endif // PLASMA_PK_UPDATE_NOTIFIER_H
@@ -0,0 +1,336 @@
+/***************************************************************************
+ *   Copyright (C) 2026 agent <agent@local>                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; see the file COPYING. If not, write to       *
+ *   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,  *
+ *   Boston, MA 02110-1301, USA.                                           *
+ ***************************************************************************/
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDBusServiceWatcher>
+#include <QTimer>
+
+#include "updatesbroker.h"
+#include "pkupdates.h"
+#include "pkupdatetable.h"
+
+namespace
+{
+    const auto s_service = QStringLiteral("org.kde.plasma.PkUpdates");
+    const auto s_path = QStringLiteral("/Updates");
+    const auto s_interface = QStringLiteral("org.kde.plasma.PkUpdates");
+    const quint32 s_stateMagic = 0x504b5553; // "PKUS"
+    const quint32 s_stateVersion = 2;
+    // how long to wait for the leader to publish the result of a check we asked for, refreshing can take a while
+    const int s_checkTimeout = 15 * 60 * 1000;
+} // namespace {
+
+UpdatesBroker::UpdatesBroker(QObject *parent) :
+    QObject(parent),
+    m_connectionName(QStringLiteral("plasma-pk-updates-%1").arg(quintptr(this))),
+    m_bus(QDBusConnection::connectToBus(QDBusConnection::SessionBus, m_connectionName)),
+    m_watcher(new QDBusServiceWatcher(s_service, m_bus, QDBusServiceWatcher::WatchForOwnerChange, this)),
+    m_checkTimer(new QTimer(this))
+{
+    m_checkTimer->setSingleShot(true);
+    m_checkTimer->setInterval(s_checkTimeout);
+    connect(m_checkTimer, &QTimer::timeout, this, &UpdatesBroker::onCheckTimeout);
+
+    if (!m_bus.isConnected()) {
+        qCWarning(PLASMA_PK_UPDATES) << "No session bus, checking for updates on our own";
+        m_leader = true;
+        return;
+    }
+
+    connect(m_watcher, &QDBusServiceWatcher::serviceOwnerChanged, this, &UpdatesBroker::onServiceOwnerChanged);
+
+    tryLead();
+    if (!m_leader) {
+        subscribe();
+        fetchState();
+    }
+}
+
+UpdatesBroker::~UpdatesBroker()
+{
+    if (m_bus.isConnected()) {
+        if (m_leader)
+            m_bus.unregisterService(s_service);
+        QDBusConnection::disconnectFromBus(m_connectionName);
+    }
+}
+
+bool UpdatesBroker::isLeader() const
+{
+    return m_leader;
+}
+
+void UpdatesBroker::publish(const PkUpdateTable &updates, bool lastCheckSuccessful)
+{
+    if (!m_leader)
+        return;
+
+    QByteArray serialized;
+    QDataStream stream(&serialized, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << updates;
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (serialized != m_updates) {
+        // a new leader continues after the generations its predecessor published
+        m_updates = serialized;
+        m_generation = qMax(now, m_generation + 1);
+    }
+    m_published = now;
+    m_lastCheckSuccessful = lastCheckSuccessful;
+
+    qCDebug(PLASMA_PK_UPDATES) << "Publishing" << updates.count() << "updates, generation" << m_generation;
+    emit updatesPublished(m_generation, m_published, m_lastCheckSuccessful);
+}
+
+void UpdatesBroker::publishStatus(uint networkState, bool updatePrepared)
+{
+    if (!m_leader || (networkState == m_networkState && updatePrepared == m_updatePrepared))
+        return;
+
+    m_networkState = networkState;
+    m_updatePrepared = updatePrepared;
+    emit statusChanged(m_networkState, m_updatePrepared);
+}
+
+void UpdatesBroker::requestCheck(bool force, bool manual)
+{
+    if (m_leader) {
+        emit checkRequested(force, manual);
+        return;
+    }
+
+    qCDebug(PLASMA_PK_UPDATES) << "Asking the leader to check for updates";
+    const qint64 requested = QDateTime::currentMSecsSinceEpoch();
+    m_checkRequested = requested;
+    m_checkTimer->start();
+    QDBusMessage msg = QDBusMessage::createMethodCall(s_service, s_path, s_interface, QStringLiteral("check"));
+    msg << force << manual;
+    auto watcher = new QDBusPendingCallWatcher(m_bus.asyncCall(msg), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, requested] (QDBusPendingCallWatcher *call) {
+        call->deleteLater();
+        const QDBusPendingReply<bool> reply = *call;
+        // answered already, or superseded by another request
+        if (m_checkRequested != requested)
+            return;
+
+        if (reply.isError() || !reply.value()) {
+            qCDebug(PLASMA_PK_UPDATES) << "The leader didn't take the check:"
+                                       << (reply.isError() ? reply.error().message() : QStringLiteral("rejected"));
+            m_checkRequested = -1;
+            m_checkTimer->stop();
+            emit checkFailed();
+        }
+    });
+}
+
+void UpdatesBroker::setCanCheck(bool canCheck)
+{
+    m_canCheck = canCheck;
+}
+
+QByteArray UpdatesBroker::state() const
+{
+    QByteArray state;
+    QDataStream stream(&state, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << s_stateMagic << s_stateVersion << m_networkState << m_updatePrepared
+           << m_generation << m_published << m_lastCheckSuccessful;
+    // serialized already, and nothing to read after it
+    state.append(m_updates);
+    return state;
+}
+
+bool UpdatesBroker::check(bool force, bool manual)
+{
+    qCDebug(PLASMA_PK_UPDATES) << "Check requested by a subscriber, manual:" << manual;
+    if (!m_canCheck) {
+        qCDebug(PLASMA_PK_UPDATES) << "Can't check right now, rejecting";
+        return false;
+    }
+    emit checkRequested(force, manual);
+    return true;
+}
+
+void UpdatesBroker::onUpdatesPublished(qint64 generation, qint64 timestamp, bool lastCheckSuccessful)
+{
+    if (m_leader)
+        return;
+
+    if (generation != m_generation) {
+        // the list changed, let the state tell about the publication along with it
+        fetchState();
+        return;
+    }
+
+    qCDebug(PLASMA_PK_UPDATES) << "The leader published generation" << generation << "again";
+    receivePublication(timestamp, lastCheckSuccessful);
+}
+
+void UpdatesBroker::onStatusChanged(uint networkState, bool updatePrepared)
+{
+    if (m_leader)
+        return;
+
+    emit statusReceived(networkState, updatePrepared);
+}
+
+void UpdatesBroker::onServiceOwnerChanged(const QString &service, const QString &oldOwner, const QString &newOwner)
+{
+    Q_UNUSED(service)
+    Q_UNUSED(oldOwner)
+
+    if (m_leader)
+        return;
+
+    if (newOwner.isEmpty()) {
+        qCDebug(PLASMA_PK_UPDATES) << "The leader went away, trying to take over";
+        tryLead();
+    } else {
+        // someone else took over, they publish once they've checked; until then get what they have
+        fetchState();
+    }
+}
+
+void UpdatesBroker::onCheckTimeout()
+{
+    if (m_checkRequested == -1)
+        return;
+
+    qCDebug(PLASMA_PK_UPDATES) << "The leader didn't publish the check we asked for";
+    m_checkRequested = -1;
+    emit checkFailed();
+}
+
+void UpdatesBroker::tryLead()
+{
+    if (!m_bus.registerService(s_service))
+        return;
+
+    if (!m_bus.registerObject(s_path, this, QDBusConnection::ExportScriptableSlots | QDBusConnection::ExportScriptableSignals)) {
+        qCWarning(PLASMA_PK_UPDATES) << "Failed to export the broker, giving up the leadership";
+        m_bus.unregisterService(s_service);
+        return;
+    }
+
+    qCDebug(PLASMA_PK_UPDATES) << "Checking for updates on behalf of the session";
+    if (m_subscribed) {
+        m_bus.disconnect(s_service, s_path, s_interface, QStringLiteral("updatesPublished"),
+                         this, SLOT(onUpdatesPublished(qint64,qint64,bool)));
+        m_bus.disconnect(s_service, s_path, s_interface, QStringLiteral("statusChanged"),
+                         this, SLOT(onStatusChanged(uint,bool)));
+        m_subscribed = false;
+    }
+    m_leader = true;
+    // checking on our own from now on
+    m_checkRequested = -1;
+    m_checkTimer->stop();
+    emit leaderChanged();
+}
+
+void UpdatesBroker::subscribe()
+{
+    m_subscribed = m_bus.connect(s_service, s_path, s_interface, QStringLiteral("updatesPublished"),
+                                 this, SLOT(onUpdatesPublished(qint64,qint64,bool)));
+    m_subscribed = m_bus.connect(s_service, s_path, s_interface, QStringLiteral("statusChanged"),
+                                 this, SLOT(onStatusChanged(uint,bool))) && m_subscribed;
+    if (!m_subscribed)
+        qCWarning(PLASMA_PK_UPDATES) << "Failed to subscribe to the leader";
+}
+
+void UpdatesBroker::fetchState()
+{
+    const QDBusMessage msg = QDBusMessage::createMethodCall(s_service, s_path, s_interface, QStringLiteral("state"));
+    auto watcher = new QDBusPendingCallWatcher(m_bus.asyncCall(msg), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this] (QDBusPendingCallWatcher *call) {
+        call->deleteLater();
+        const QDBusPendingReply<QByteArray> reply = *call;
+        if (reply.isError()) {
+            qCDebug(PLASMA_PK_UPDATES) << "Failed to get the state from the leader:" << reply.error().message();
+            // a publication we were waiting for might be behind it
+            if (m_checkRequested != -1) {
+                m_checkRequested = -1;
+                m_checkTimer->stop();
+                emit checkFailed();
+            }
+            return;
+        }
+        readState(reply.value());
+    });
+}
+
+void UpdatesBroker::readState(const QByteArray &state)
+{
+    if (m_leader)
+        return;
+
+    QDataStream stream(state);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic, version;
+    uint networkState;
+    bool updatePrepared, lastCheckSuccessful;
+    qint64 generation, published;
+    stream >> magic >> version;
+    if (stream.status() != QDataStream::Ok || magic != s_stateMagic || version != s_stateVersion) {
+        qCWarning(PLASMA_PK_UPDATES) << "Ignoring incompatible state from the leader";
+        return;
+    }
+    stream >> networkState >> updatePrepared >> generation >> published >> lastCheckSuccessful;
+    if (stream.status() != QDataStream::Ok) {
+        qCWarning(PLASMA_PK_UPDATES) << "Failed to read the state from the leader";
+        return;
+    }
+    emit statusReceived(networkState, updatePrepared);
+
+    // nothing published yet
+    if (published == -1)
+        return;
+
+    if (generation != m_generation) {
+        PkUpdateTable updates;
+        stream >> updates;
+        if (stream.status() != QDataStream::Ok) {
+            qCWarning(PLASMA_PK_UPDATES) << "Failed to read the updates from the leader";
+            return;
+        }
+
+        qCDebug(PLASMA_PK_UPDATES) << "Received" << updates.count() << "updates from the leader, generation" << generation;
+        m_generation = generation;
+        emit updatesReceived(updates);
+    }
+    receivePublication(published, lastCheckSuccessful);
+}
+
+void UpdatesBroker::receivePublication(qint64 timestamp, bool lastCheckSuccessful)
+{
+    // both run on the same host, so the clocks agree
+    const bool checkPending = timestamp < m_checkRequested;
+    if (!checkPending) {
+        m_checkRequested = -1;
+        m_checkTimer->stop();
+    }
+
+    qCDebug(PLASMA_PK_UPDATES) << "Received a publication from the leader, check pending:" << checkPending;
+    emit publicationReceived(lastCheckSuccessful, checkPending);
+}
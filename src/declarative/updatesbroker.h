@@ -0,0 +1,166 @@
+/***************************************************************************
+ *   Copyright (C) 2026 agent <agent@local>                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; see the file COPYING. If not, write to       *
+ *   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,  *
+ *   Boston, MA 02110-1301, USA.                                           *
+ ***************************************************************************/
+
+#ifndef PLASMA_PK_UPDATES_BROKER_H
+#define PLASMA_PK_UPDATES_BROKER_H
+
+#include <QByteArray>
+#include <QDBusConnection>
+#include <QObject>
+
+class QDBusServiceWatcher;
+class QTimer;
+class PkUpdateTable;
+
+/**
+ * @brief The UpdatesBroker class
+ *
+ * Shares a single update check among all the PkUpdates instances of a
+ * session. The first instance to claim the org.kde.plasma.PkUpdates service
+ * on the session bus becomes the leader: it owns the PackageKit transactions
+ * for checking and publishes the update list after each check. All other
+ * instances subscribe to it, forwarding check requests to the leader instead
+ * of talking to the daemon themselves. When the leader goes away, one of the
+ * subscribers takes over.
+ *
+ * Each publication only announces the generation of the list, which changes
+ * along with its contents. The subscribers fetch the list itself only when
+ * they don't have that generation yet. The leader also shares the network
+ * state and whether an offline update is prepared, so that the subscribers
+ * don't need to watch the daemon for them.
+ *
+ * Each broker uses its own bus connection, so that several instances living
+ * in the same process (e.g. multiple applets in plasmashell) don't all end up
+ * owning the service.
+ */
+class UpdatesBroker : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.kde.plasma.PkUpdates")
+
+public:
+    explicit UpdatesBroker(QObject *parent = nullptr);
+    ~UpdatesBroker();
+
+    /**
+     * @return whether this instance checks for updates on behalf of the session
+     */
+    bool isLeader() const;
+
+    /**
+     * Publish the update list to the subscribers, only meaningful for the leader
+     */
+    void publish(const PkUpdateTable &updates, bool lastCheckSuccessful);
+
+    /**
+     * Share the network state of the daemon and whether an offline update is prepared with the
+     * subscribers, only meaningful for the leader
+     */
+    void publishStatus(uint networkState, bool updatePrepared);
+
+    /**
+     * Ask the leader to check for updates, see checkFailed() for when it doesn't
+     */
+    void requestCheck(bool force, bool manual);
+
+    /**
+     * Set whether the leader can check for updates right now, it rejects the requests of the subscribers otherwise
+     */
+    void setCanCheck(bool canCheck);
+
+public slots:
+    /**
+     * @return the status and the last published update list, if any
+     */
+    Q_SCRIPTABLE QByteArray state() const;
+
+    /**
+     * Check for updates on behalf of a subscriber
+     * @return false if the check can't be done right now, e.g. while offline
+     */
+    Q_SCRIPTABLE bool check(bool force, bool manual);
+
+signals:
+    /**
+     * Emitted when this instance became the leader
+     */
+    void leaderChanged();
+
+    /**
+     * Emitted when a subscriber received a generation of the update list it didn't have yet,
+     * followed by publicationReceived()
+     */
+    void updatesReceived(const PkUpdateTable &updates);
+
+    /**
+     * Emitted when the leader published the result of a check, whether the list changed or not
+     * @param checkPending whether it was published before the leader handled our last requestCheck()
+     */
+    void publicationReceived(bool lastCheckSuccessful, bool checkPending);
+
+    /**
+     * Emitted when a subscriber received the status the leader shares
+     */
+    void statusReceived(uint networkState, bool updatePrepared);
+
+    /**
+     * Emitted when the leader couldn't be reached, rejected our last requestCheck() or didn't publish
+     * anything for it in time
+     */
+    void checkFailed();
+
+    /**
+     * Emitted when a subscriber asked the leader to check for updates
+     */
+    void checkRequested(bool force, bool manual);
+
+    Q_SCRIPTABLE void updatesPublished(qint64 generation, qint64 timestamp, bool lastCheckSuccessful);
+    Q_SCRIPTABLE void statusChanged(uint networkState, bool updatePrepared);
+
+private slots:
+    void onUpdatesPublished(qint64 generation, qint64 timestamp, bool lastCheckSuccessful);
+    void onStatusChanged(uint networkState, bool updatePrepared);
+    void onServiceOwnerChanged(const QString &service, const QString &oldOwner, const QString &newOwner);
+    void onCheckTimeout();
+
+private:
+    void tryLead();
+    void subscribe();
+    void fetchState();
+    void readState(const QByteArray &state);
+    void receivePublication(qint64 timestamp, bool lastCheckSuccessful);
+
+    QString m_connectionName;
+    QDBusConnection m_bus;
+    QDBusServiceWatcher * m_watcher;
+    QTimer * m_checkTimer;
+    bool m_canCheck = true;
+    bool m_leader = false;
+    bool m_subscribed = false;
+    qint64 m_checkRequested = -1;
+    // the leader's update list as published, and when it last changed; a subscriber only keeps the generation
+    QByteArray m_updates;
+    qint64 m_generation = -1;
+    qint64 m_published = -1;
+    bool m_lastCheckSuccessful = false;
+    uint m_networkState = 0;
+    bool m_updatePrepared = false;
+};
+
+#endif // PLASMA_PK_UPDATES_BROKER_H
@@ -0,0 +1,187 @@
+/***************************************************************************
+ *   Copyright (C) 2026 agent <agent@local>                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; see the file COPYING. If not, write to       *
+ *   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,  *
+ *   Boston, MA 02110-1301, USA.                                           *
+ ***************************************************************************/
+
+#include <random>
+
+#include <QDateTime>
+#include <QTimer>
+
+#include <KConfigGroup>
+
+#include "updatescheduler.h"
+#include "pkupdates.h"
+
+namespace
+{
+    // how long to wait at most before checking when a check is overdue, e.g. after login
+    const qint64 s_startupSplay = 15 * 60 * 1000;
+    // the maximum random delay added to the regular check interval
+    const qint64 s_maxSplay = 60 * 60 * 1000;
+    // how often to look up the updates against the existing metadata between two refreshes
+    const qint64 s_localCheckInterval = 6 * 60 * 60 * 1000;
+    // delay before retrying a failed automatic check, doubled on each failure
+    const qint64 s_retryDelay = 5 * 60 * 1000;
+    // delay before trying a due check again that had to wait for another transaction
+    const int s_busyRetryDelay = 60 * 1000;
+    // re-evaluate at least this often, QTimer can't cover a whole month and the clock might jump
+    const int s_maxTimerInterval = 60 * 60 * 1000;
+
+    qint64 splay(qint64 max)
+    {
+        static std::mt19937_64 generator{std::random_device{}()};
+        if (max <= 0)
+            return 0;
+        return std::uniform_int_distribution<qint64>(0, max - 1)(generator);
+    }
+} // namespace {
+
+UpdateScheduler::UpdateScheduler(const KSharedConfigPtr &config, QObject *parent) :
+    QObject(parent),
+    m_config(config),
+    m_timer(new QTimer(this))
+{
+    m_timer->setSingleShot(true);
+    connect(m_timer, &QTimer::timeout, this, &UpdateScheduler::onTimeout);
+}
+
+UpdateScheduler::~UpdateScheduler()
+{
+}
+
+int UpdateScheduler::interval() const
+{
+    return m_interval;
+}
+
+void UpdateScheduler::setInterval(int interval)
+{
+    interval = qMax(0, interval);
+    if (interval == m_interval)
+        return;
+
+    const bool firstRun = m_interval == 0;
+    m_interval = interval;
+
+    if (m_interval == 0) {
+        m_timer->stop();
+        m_due = false;
+        m_nextRun = -1;
+        return;
+    }
+
+    // resume the persisted schedule, unless it doesn't match the interval any more
+    KConfigGroup grp(m_config, "General");
+    const qint64 persisted = grp.readEntry<qint64>("NextCheck", -1);
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (firstRun && persisted > now && persisted <= now + m_interval * qint64(1000) + s_maxSplay) {
+        qCDebug(PLASMA_PK_UPDATES) << "Resuming the update check schedule at" << QDateTime::fromMSecsSinceEpoch(persisted);
+        m_nextRun = persisted;
+        startTimer();
+    } else {
+        reschedule();
+    }
+}
+
+qint64 UpdateScheduler::nextRun() const
+{
+    return m_nextRun;
+}
+
+bool UpdateScheduler::isDue() const
+{
+    return m_due;
+}
+
+void UpdateScheduler::reschedule()
+{
+    m_due = false;
+    if (m_interval == 0)
+        return;
+
+    setNextRun(computeNextRun());
+}
+
+void UpdateScheduler::retryLater()
+{
+    if (!m_due)
+        return;
+
+    // the check stays due, onTimeout() announces it again
+    m_timer->start(s_busyRetryDelay);
+}
+
+void UpdateScheduler::onTimeout()
+{
+    if (m_nextRun == -1)
+        return;
+
+    if (QDateTime::currentMSecsSinceEpoch() < m_nextRun) {
+        startTimer();
+        return;
+    }
+
+    qCDebug(PLASMA_PK_UPDATES) << "Update check is due";
+    m_due = true;
+    emit checkDue();
+}
+
+qint64 UpdateScheduler::computeNextRun() const
+{
+    KConfigGroup grp(m_config, "General");
+    const qint64 lastRefresh = grp.readEntry<qint64>("Timestamp", -1);
+    const qint64 lastCheck = grp.readEntry<qint64>("LastCheck", -1);
+    const int failCount = grp.readEntry<int>("FailedAutoRefeshCount", 0);
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const qint64 interval = m_interval * qint64(1000);
+
+    if (failCount > 0) {
+        const qint64 backoff = qMin(s_retryDelay << qMin(failCount - 1, 16), interval);
+        return now + backoff + splay(backoff / 4);
+    }
+
+    if (lastRefresh != -1) {
+        qint64 next = lastRefresh + interval + splay(qMin(interval / 10, s_maxSplay));
+        // the checks before the refresh is due don't need the network, see PkUpdates::checkUpdatesIfNeeded()
+        if (lastCheck != -1)
+            next = qMin(next, lastCheck + qMin(s_localCheckInterval, interval / 2));
+        if (next > now)
+            return next;
+    }
+
+    // never checked or overdue
+    return now + splay(s_startupSplay);
+}
+
+void UpdateScheduler::setNextRun(qint64 nextRun)
+{
+    m_nextRun = nextRun;
+    qCDebug(PLASMA_PK_UPDATES) << "Next update check scheduled at" << QDateTime::fromMSecsSinceEpoch(m_nextRun);
+
+    KConfigGroup grp(m_config, "General");
+    grp.writeEntry("NextCheck", m_nextRun);
+    emit configChanged();
+
+    startTimer();
+}
+
+void UpdateScheduler::startTimer()
+{
+    const qint64 remaining = qMax<qint64>(0, m_nextRun - QDateTime::currentMSecsSinceEpoch());
+    m_timer->start(int(qMin<qint64>(remaining, s_maxTimerInterval)));
+}
@@ -0,0 +1,108 @@
+/***************************************************************************
+ *   Copyright (C) 2026 agent <agent@local>                                *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; see the file COPYING. If not, write to       *
+ *   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,  *
+ *   Boston, MA 02110-1301, USA.                                           *
+ ***************************************************************************/
+
+
+#ifndef PLASMA_PK_UPDATE_SCHEDULER_H
+#define PLASMA_PK_UPDATE_SCHEDULER_H
+
+#include <QObject>
+
+#include <KSharedConfig>
+
+class QTimer;
+
+/**
+ * @brief The UpdateScheduler class
+ *
+ * Decides when the next automatic update check is due. The next run is the
+ * time of the last successful cache refresh plus the check interval, splayed
+ * by a random delay so that machines booted at the same time don't all hit the
+ * mirrors together. In between, a check is due every few hours after the last
+ * one (the LastCheck config entry); the metadata is still younger than the
+ * check interval then, so it only looks up the updates without refreshing. Failed automatic checks are retried with an exponential
+ * backoff based on the FailedAutoRefeshCount config entry. The next run time
+ * is persisted, so it survives restarts of the shell; the config is only
+ * written to, syncing it is up to the owner (see configChanged()).
+ */
+class UpdateScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit UpdateScheduler(const KSharedConfigPtr &config, QObject *parent = nullptr);
+    ~UpdateScheduler();
+
+    /**
+     * @return the check interval in seconds, 0 if automatic checks are disabled
+     */
+    int interval() const;
+
+    /**
+     * Set the check interval in seconds, 0 disables automatic checks
+     */
+    void setInterval(int interval);
+
+    /**
+     * @return the time (in milliseconds since the epoch) of the next check, -1 if none is scheduled
+     */
+    qint64 nextRun() const;
+
+    /**
+     * @return whether a check is due and has not been performed yet
+     */
+    bool isDue() const;
+
+public slots:
+    /**
+     * Compute and persist the next run from the current config, typically after a check has finished
+     */
+    void reschedule();
+
+    /**
+     * Emit checkDue() again shortly, for a due check that couldn't be started yet
+     */
+    void retryLater();
+
+signals:
+    /**
+     * Emitted when it's time to check for updates
+     */
+    void checkDue();
+
+    /**
+     * Emitted when the schedule was written to the config, which needs syncing
+     */
+    void configChanged();
+
+private slots:
+    void onTimeout();
+
+private:
+    qint64 computeNextRun() const;
+    void setNextRun(qint64 nextRun);
+    void startTimer();
+
+    KSharedConfigPtr m_config;
+    QTimer * m_timer;
+    int m_interval = 0;
+    qint64 m_nextRun = -1;
+    bool m_due = false;
+};
+
+#endif // PLASMA_PK_UPDATE_SCHEDULER_H
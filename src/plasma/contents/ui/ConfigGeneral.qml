@@ -33,6 +33,9 @@ Item {
     property alias cfg_monthly: monthly.checked
     property alias cfg_check_on_mobile: mobile.checked
     property alias cfg_check_on_battery: battery.checked
+    property alias cfg_download_ahead: downloadAhead.checked
+    property alias cfg_offline_updates: offlineUpdates.checked
+    property alias cfg_auto_install_security: autoInstallSecurity.checked
 
     Column {
         id: pageColumn
@@ -69,5 +72,17 @@ Item {
             id: battery
             text: i18n("Check for updates even when on battery")
         }
+        CheckBox {
+            id: downloadAhead
+            text: i18n("Download updates in the background before installing them")
+        }
+        CheckBox {
+            id: offlineUpdates
+            text: i18n("Install updates when restarting the computer")
+        }
+        CheckBox {
+            id: autoInstallSecurity
+            text: i18n("Install security updates automatically")
+        }
     }
 }
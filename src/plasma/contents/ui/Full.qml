@@ -31,9 +31,8 @@ import org.kde.plasma.PackageKit 1.0
 Item {
     id: fullRepresentation
 
-    property bool anySelected: checkAnySelected()
-    property bool allSelected: checkAllSelected()
-    property bool populatePreSelected: true
+    readonly property bool anySelected: PkUpdates.updatesModel.anySelected
+    readonly property bool allSelected: PkUpdates.updatesModel.allSelected
 
     Binding {
         target: timestampLabel
@@ -44,13 +43,16 @@ Item {
 
     Connections {
         target: PkUpdates
-        onUpdatesChanged: populateModel()
         onUpdateDetail: updateDetails(packageID, updateText, urls)
         onUpdatesInstalled: plasmoid.expanded = false
         onEulaRequired: eulaDialog.showPrompt(eulaID, packageID, vendor, licenseAgreement)
     }
 
-    Component.onCompleted: populateModel()
+    Connections {
+        target: plasmoid
+        // the user is about to interact with us, don't wait for the startup delay
+        onExpandedChanged: if (plasmoid.expanded) PkUpdates.activate()
+    }
 
     Dialog {
         property string eulaID: ""
@@ -109,10 +111,6 @@ Item {
         }
     }
 
-    ListModel {
-        id: updatesModel
-    }
-
     PlasmaExtras.Heading {
         id: header
         level: 4
@@ -145,7 +143,10 @@ Item {
             font.pointSize: theme.smallestFont.pointSize;
             opacity: 0.6;
             text: {
-                if (PkUpdates.isActive)
+                if (PkUpdates.isActive && PkUpdates.installStageCount > 1)
+                    return i18nc("Batch n of m: status", "Batch %1 of %2: %3", PkUpdates.installStage,
+                                 PkUpdates.installStageCount, PkUpdates.statusMessage)
+                else if (PkUpdates.isActive)
                     return PkUpdates.statusMessage
                 else if (PkUpdates.isNetworkOnline)
                     return i18n("Updates are automatically checked %1.<br>Click the 'Check For Updates' button below to search for updates manually.",
@@ -182,18 +183,27 @@ Item {
             top: statusbar.bottom
         }
 
+        PlasmaComponents.TextField {
+            id: searchField
+            Layout.fillWidth: true
+            visible: updatesScrollArea.visible
+            clearButtonShown: true
+            placeholderText: i18n("Search updates")
+        }
+
         PlasmaExtras.ScrollArea {
             id: updatesScrollArea
             Layout.fillWidth: true
             Layout.fillHeight: true
-            visible: PkUpdates.count && PkUpdates.isNetworkOnline && !PkUpdates.isActive
+            // the updates show up while they're still arriving
+            visible: PkUpdates.count && PkUpdates.isNetworkOnline && (!PkUpdates.isActive || PkUpdates.isGettingUpdates)
 
             ListView {
                 id: updatesView
                 clip: true
-                model: PlasmaCore.SortFilterModel {
-                    sourceModel: updatesModel
-                    filterRole: "name"
+                model: PkUpdatesFilterModel {
+                    updatesModel: PkUpdates.updatesModel
+                    filterText: searchField.text
                 }
                 anchors.fill: parent
                 currentIndex: -1
@@ -207,13 +217,6 @@ Item {
                             PkUpdates.getUpdateDetails(id)
                         }
                     }
-                    onCheckedStateChanged: {
-                        if (checked) {
-                            fullRepresentation.anySelected = true
-                        } else {
-                            fullRepresentation.anySelected = checkAnySelected()
-                        }
-                    }
                 }
             }
         }
@@ -246,17 +249,7 @@ Item {
                 enabled: true
 
                 onClicked: {
-                    if (chkSelectAll.checkedState == Qt.Unchecked) {
-                        populatePreSelected = true
-                        populateModel()
-                    } else if (chkSelectAll.checkedState == Qt.PartiallyChecked) {
-                        populatePreSelected = true
-                        populateModel()
-                    } else {
-                        populatePreSelected = false
-                        populateModel()
-                    }
-                    fullRepresentation.anySelected = checkAnySelected()
+                    PkUpdates.updatesModel.setAllSelected(chkSelectAll.checkedState != Qt.Checked)
                 }
             }
         }
@@ -278,70 +271,54 @@ Item {
         PlasmaComponents.Button {
             id: btnUpdate
             visible: PkUpdates.count && PkUpdates.isNetworkOnline && !PkUpdates.isActive
-            enabled: fullRepresentation.anySelected
+            enabled: fullRepresentation.anySelected || PkUpdates.canResumeInstall || PkUpdates.updatePrepared
             anchors {
                 bottom: parent.bottom
                 bottomMargin: Math.round(units.gridUnit / 3)
                 horizontalCenter: parent.horizontalCenter
             }
-            text: i18n("Install Updates")
-            tooltip: i18n("Performs the software update")
-            onClicked: PkUpdates.installUpdates(selectedPackages())
+            text: {
+                if (PkUpdates.canResumeInstall)
+                    return i18n("Resume Installation")
+                else if (PkUpdates.updatePrepared)
+                    return i18n("Restart to Update")
+                else if (PkUpdates.offlineUpdates)
+                    return i18n("Prepare Updates")
+                return i18n("Install Updates")
+            }
+            tooltip: {
+                if (PkUpdates.canResumeInstall)
+                    return i18n("Continues the software update with the batch that failed")
+                else if (PkUpdates.updatePrepared)
+                    return i18n("Restarts the computer and installs the prepared updates")
+                else if (PkUpdates.offlineUpdates)
+                    return i18n("Downloads the updates to install them on the next restart")
+                return i18n("Performs the software update")
+            }
+            onClicked: {
+                if (PkUpdates.canResumeInstall)
+                    PkUpdates.resumeStagedInstall()
+                else if (PkUpdates.updatePrepared)
+                    PkUpdates.restartToUpdate()
+                else
+                    PkUpdates.installSelected()
+            }
         }
 
         PlasmaComponents.BusyIndicator {
-            running: PkUpdates.isActive
+            running: PkUpdates.isActive && !updatesScrollArea.visible
             visible: running
             anchors.centerIn: parent
         }
     }
 
-    function checkAnySelected() {
-        for (var i = 0; i < updatesModel.count; i++) {
-            var pkg = updatesModel.get(i)
-            if (pkg.selected)
-                return true
-        }
-        return false
-    }
-
-    function checkAllSelected() {
-        for (var i = 0; i < updatesModel.count; i++) {
-            var pkg = updatesModel.get(i)
-            if (!pkg.selected)
-                return false
-        }
-        return true
-    }
-
-    function selectedPackages() {
-        var result = []
-        for (var i = 0; i < updatesModel.count; i++) {
-            var pkg = updatesModel.get(i)
-            if (pkg.selected) {
-                print("Package " + pkg.id + " selected for update")
-                result.push(pkg.id)
-            }
-        }
-        return result
-    }
-
-    function populateModel() {
-        print("Populating model")
-        updatesModel.clear()
-        var packages = PkUpdates.packages
-        for (var id in packages) {
-            if (packages.hasOwnProperty(id)) {
-                var desc = packages[id]
-                updatesModel.append({"selected": populatePreSelected, "id": id, "name": PkUpdates.packageName(id), "desc": desc, "version": PkUpdates.packageVersion(id)})
-            }
-        }
-    }
-
     function updateDetails(packageID, updateText, urls) {
         //print("Got update details for: " + packageID)
         print("Update text: " + updateText)
         print("URLs: " + urls)
+        // the user might have expanded another package meanwhile
+        if (!updatesView.currentItem || updatesView.currentItem.packageID !== packageID)
+            return
         updatesView.currentItem.updateText = updateText
         updatesView.currentItem.updateUrls = urls
     }
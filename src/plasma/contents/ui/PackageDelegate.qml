@@ -25,10 +25,12 @@ import QtQuick.Controls 1.3
 import org.kde.plasma.components 2.0 as PlasmaComponents
 import org.kde.plasma.extras 2.0 as PlasmaExtras
 import org.kde.plasma.core 2.0 as PlasmaCore
+import org.kde.plasma.PackageKit 1.0
 
 PlasmaComponents.ListItem {
     id: packageDelegate
 
+    readonly property string packageID: id
     property string updateText
     property variant updateUrls: []
     readonly property bool expanded: ListView.isCurrentItem
@@ -40,6 +42,9 @@ PlasmaComponents.ListItem {
     enabled: true
     checked: containsMouse || expanded
 
+    // fetch the details of the visible rows in batches, so that expanding them is instant
+    Component.onCompleted: PkUpdates.prefetchUpdateDetails(id)
+
     PlasmaComponents.CheckBox {
         id: checkbox
         anchors {
@@ -48,7 +53,7 @@ PlasmaComponents.ListItem {
         }
         checked: selected
         onClicked: {
-            updatesModel.setProperty(index, "selected", checked)
+            model.selected = checked
             packageDelegate.checkedStateChanged(checked)
         }
     }
@@ -86,7 +91,7 @@ PlasmaComponents.ListItem {
             elide: Text.ElideRight;
             font.pointSize: theme.smallestFont.pointSize;
             opacity: 0.6;
-            text: desc
+            text: summary
         }
     }
 
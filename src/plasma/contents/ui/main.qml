@@ -39,24 +39,68 @@ Item
 
     property bool checkOnMobile: plasmoid.configuration.check_on_mobile
     property bool checkOnBattery: plasmoid.configuration.check_on_battery
+    property bool downloadAhead: plasmoid.configuration.download_ahead
+    property bool offlineUpdates: plasmoid.configuration.offline_updates
+    property bool autoInstallSecurity: plasmoid.configuration.auto_install_security
+    property int startupDelay: plasmoid.configuration.startup_delay
+    property int detailsCacheSize: plasmoid.configuration.details_cache_size
 
     readonly property int secsInDay: 60 * 60 * 24;
     readonly property int secsInWeek: secsInDay * 7;
     readonly property int secsInMonth: secsInDay * 30;
 
-    readonly property bool networkAllowed: PkUpdates.isNetworkMobile ? checkOnMobile : PkUpdates.isNetworkOnline
-    readonly property bool batteryAllowed: PkUpdates.isOnBattery ? checkOnBattery : true
-
-    Timer {
-        id: timer
-        repeat: true
-        triggeredOnStart: true
-        interval: 1000 * 60 * 60; // 1 hour
-        onTriggered: {
-            if (needsForcedUpdate() && networkAllowed && batteryAllowed) {
-                PkUpdates.checkUpdates(true /* force */, false /* manual */);
-            }
-        }
+    Binding {
+        target: PkUpdates
+        property: "startupDelay"
+        value: startupDelay * 1000
+    }
+
+    Binding {
+        target: PkUpdates
+        property: "detailsCacheSize"
+        value: detailsCacheSize * 1024
+    }
+
+    Binding {
+        target: PkUpdates
+        property: "detailsVisible"
+        value: plasmoid.expanded
+    }
+
+    Binding {
+        target: PkUpdates
+        property: "checkInterval"
+        value: checkInterval()
+    }
+
+    Binding {
+        target: PkUpdates
+        property: "checkOnMobile"
+        value: checkOnMobile
+    }
+
+    Binding {
+        target: PkUpdates
+        property: "checkOnBattery"
+        value: checkOnBattery
+    }
+
+    Binding {
+        target: PkUpdates
+        property: "downloadAhead"
+        value: downloadAhead
+    }
+
+    Binding {
+        target: PkUpdates
+        property: "offlineUpdates"
+        value: offlineUpdates
+    }
+
+    Binding {
+        target: PkUpdates
+        property: "autoInstallSecurity"
+        value: autoInstallSecurity
     }
 
     Binding {
@@ -74,27 +118,14 @@ Item
         }
     }
 
-    function needsForcedUpdate() {
-        var secs = (Date.now() - PkUpdates.lastRefreshTimestamp())/1000; // compare with the saved timestamp
-        if (secs < 0) { // never checked before
-            return true;
-        } else if (checkDaily) {
-            return secs >= secsInDay;
+    function checkInterval() {
+        if (checkDaily) {
+            return secsInDay;
         } else if (checkWeekly) {
-            return secs >= secsInWeek;
+            return secsInWeek;
         } else if (checkMonthly) {
-            return secs >= secsInMonth;
+            return secsInMonth;
         }
-        return false;
-    }
-
-    Connections {
-        target: PkUpdates
-        onNetworkStateChanged: timer.restart()
-        onIsOnBatteryChanged: timer.restart()
-    }
-
-    Component.onCompleted: {
-        timer.start()
+        return 0; // no automatic checks
     }
 }